@@ -6,9 +6,18 @@
 #include <set>
 #include <execution>
 #include <array>
+#include <cmath>
+#include <bitset>
 
 #include "fmt/format.h"
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include <cerrno>
+
 #if __cpp_lib_string_view
 
 #else
@@ -205,6 +214,46 @@
 				obj->null_parent();
 			}
 		}
+
+		bool StructuredPtr::is_clean() const {
+			if (type == 1) {
+				return arr->is_clean();
+			}
+			else if (type == 2) {
+				return obj->is_clean();
+			}
+			return false;
+		}
+
+		void StructuredPtr::mark_dirty() {
+			StructuredPtr x = *this;
+			while (x.is_array() || x.is_object()) {
+				Pointer& p = x.is_array() ? x.arr->parent : x.obj->parent;
+				if (!p.mid_type()) {
+					break; // then parents are also dirty.
+				}
+				p.set_mid_type(0);
+				x = x.get_parent();
+			}
+		}
+
+		void StructuredPtr::set_clean() {
+			if (type == 1) {
+				arr->parent.set_mid_type(1);
+			}
+			else if (type == 2) {
+				obj->parent.set_mid_type(1);
+			}
+		}
+
+		void StructuredPtr::set_frozen() {
+			if (type == 1) {
+				arr->parent.set_frozen_type();
+			}
+			else if (type == 2) {
+				obj->parent.set_frozen_type();
+			}
+		}
 		
 		uint64_t StructuredPtr::find_by_key(const _Value & key) const{ // find without key`s converting ( \uxxxx )
 			if (type == 2) {
@@ -424,29 +473,29 @@
 		}
 
 		void StructuredPtr::add_user_type(int64_t key_buf_idx, int64_t key_next_buf_idx, char* buf,
-			_ValueType type, uint64_t key_token_idx) {
+			_ValueType type, uint64_t key_token_idx, bool parent) {
 			if (this->type == 1) {
-				return arr->add_user_type(key_buf_idx, key_next_buf_idx, buf, type, key_token_idx);
+				return arr->add_user_type(key_buf_idx, key_next_buf_idx, buf, type, key_token_idx, parent);
 			}
 			if (this->type == 2) {
-				return obj->add_user_type(key_buf_idx, key_next_buf_idx, buf, type, key_token_idx);
+				return obj->add_user_type(key_buf_idx, key_next_buf_idx, buf, type, key_token_idx, parent);
 			}
 			if (this->type == 3) {
-				return pj->add_user_type(key_buf_idx, key_next_buf_idx, buf, type, key_token_idx);
+				return pj->add_user_type(key_buf_idx, key_next_buf_idx, buf, type, key_token_idx, parent);
 			}
 			//std::cout << "chk 3";
 			return;
 		}
 
-		void StructuredPtr::add_user_type(_ValueType type) {
+		void StructuredPtr::add_user_type(_ValueType type, bool parent) {
 			if (this->type == 1) {
-				return arr->add_user_type(type);
+				return arr->add_user_type(type, parent);
 			}
 			if (this->type == 2) {
-				return obj->add_user_type(type);
+				return obj->add_user_type(type, parent);
 			}
 			if (this->type == 3) {
-				return pj->add_user_type(type);
+				return pj->add_user_type(type, parent);
 			}
 			//std::cout << "chk 4";
 			return;
@@ -694,6 +743,31 @@ namespace claujson {
 		claujson::clean(x);
 	}
 
+	void Document::freeze() {
+		if (frozen) {
+			return;
+		}
+		frozen = true;
+
+		if (!x.is_structured()) {
+			return;
+		}
+		std_vector<StructuredPtr> stack{ StructuredPtr(x) };
+		while (!stack.empty()) {
+			StructuredPtr now = stack.back();
+			stack.pop_back();
+			now.set_frozen();
+
+			const uint64_t len = now.get_data_size();
+			for (uint64_t i = 0; i < len; ++i) {
+				const _Value& y = now.get_value_list(i);
+				if (y.is_structured()) {
+					stack.push_back(StructuredPtr(y));
+				}
+			}
+		}
+	}
+
 	claujson_inline 
 	bool ConvertString(claujson::_Value& data, const char* text, uint64_t len) {
 		uint8_t sbuf[1024 + 1 + _simdjson::_SIMDJSON_PADDING];
@@ -956,48 +1030,216 @@ namespace claujson {
 	class StrStream {
 	private:
 		//std::string m_buffer;
-		fmt::memory_buffer m_buffer;
+		fmt::memory_buffer m_buffer; // used if no sink.
+		Sink* m_sink = nullptr;
+		char* m_ptr = nullptr;
+		uint64_t m_pos = 0;
+		uint64_t m_cap = 0;
+		bool m_fail = false;
+
+		// at least `n` bytes are writable after this.
+		void grow(uint64_t n) {
+			if (m_sink) {
+				if (!m_fail && m_sink->commit(m_pos)) {
+					m_pos = 0;
+					m_ptr = m_sink->next(n, &m_cap);
+					if (m_ptr && m_cap >= n) {
+						return;
+					}
+				}
+				// sink is broken, just drop the rest.
+				m_fail = true;
+				m_pos = 0;
+				m_buffer.resize(std::max<uint64_t>(n, 256));
+				m_ptr = m_buffer.data();
+				m_cap = m_buffer.size();
+				return;
+			}
+			uint64_t new_cap = std::max<uint64_t>(m_pos + n, std::max<uint64_t>(m_cap * 2, 256));
+			m_buffer.resize(new_cap);
+			m_ptr = m_buffer.data();
+			m_cap = new_cap;
+		}
+		claujson_inline void reserve(uint64_t n) {
+			if (m_cap - m_pos < n) {
+				grow(n);
+			}
+		}
 	public:
+		StrStream() { }
+		explicit StrStream(Sink* sink) : m_sink(sink) { }
 
+		StrStream(StrStream&& other) noexcept : m_buffer(std::move(other.m_buffer)), m_sink(other.m_sink),
+			m_pos(other.m_pos), m_cap(other.m_cap), m_fail(other.m_fail) {
+			m_ptr = m_sink && !m_fail ? other.m_ptr : m_buffer.data();
+		}
+	public:
 		const char* buf() const {
-			return m_buffer.data();
+			return m_ptr;
 		}
 		uint64_t buf_size() const {
-			return m_buffer.size();
+			return m_pos;
+		}
+
+		// for sink, end of writing. returns false if sink fails.
+		bool end() {
+			if (!m_sink || m_fail) {
+				return !m_fail;
+			}
+			if (!m_sink->commit(m_pos)) {
+				m_fail = true;
+				return false;
+			}
+			m_pos = 0;
+			m_cap = 0;
+			m_ptr = nullptr;
+			return m_sink->flush();
 		}
 
 		StrStream& add_char(char x) {
-			m_buffer.push_back(x);
+			reserve(1);
+			m_ptr[m_pos] = x;
+			++m_pos;
 			return *this;
 		}
 
 		StrStream& add_float(double x) {
-			fmt::format_to(std::back_inserter(m_buffer), "{:f}", x);
+			reserve(64);
+			auto result = fmt::format_to_n(m_ptr + m_pos, m_cap - m_pos, "{:f}", x);
+			if (result.size <= m_cap - m_pos) {
+				m_pos += result.size;
+			}
+			else { // big number..
+				fmt::memory_buffer temp;
+				fmt::format_to(std::back_inserter(temp), "{:f}", x);
+				add_n(temp.data(), temp.size());
+			}
 			//m_buffer.Double(x); // fmt::format_to(std::back_inserter(out), "{:f}", x);
 			return *this;
 		}
 
 		StrStream& add_int(int64_t x) {
-			fmt::format_to(std::back_inserter(m_buffer), "{}", x);
+			reserve(32);
+			m_pos = fmt::format_to(m_ptr + m_pos, "{}", x) - m_ptr;
 			//m_buffer.Int64(x); // fmt::format_to(std::back_inserter(out), "{}", x);
 			return *this;
 		}
 
 		StrStream& add_uint(uint64_t x) {
-			fmt::format_to(std::back_inserter(m_buffer), "{}", x);
+			reserve(32);
+			m_pos = fmt::format_to(m_ptr + m_pos, "{}", x) - m_ptr;
 			//m_buffer.Uint64(x); // fmt::format_to(std::back_inserter(out), "{}", x);
 			return *this;
 		}
 
-		StrStream& add_2(const char* str) {
-			while (str[0] != '\0') {
-				add_char(str[0]);
-				++str;
+		// sink can be smaller than `n`.
+		StrStream& add_n(const char* str, uint64_t n) {
+			if (n <= 64) { // one copy.
+				reserve(n);
+				memcpy(m_ptr + m_pos, str, n);
+				m_pos += n;
+				return *this;
 			}
+			while (n > 0) {
+				reserve(1);
+				uint64_t len = std::min(n, m_cap - m_pos);
+				memcpy(m_ptr + m_pos, str, len);
+				m_pos += len;
+				str += len;
+				n -= len;
+			}
+			return *this;
+		}
+
+		StrStream& add_2(const char* str) {
+			return add_n(str, strlen(str));
+		}
+
+		// string literal, fixed size copy.
+		template <uint64_t N>
+		claujson_inline StrStream& add_lit(const char(&str)[N]) {
+			reserve(N - 1);
+			memcpy(m_ptr + m_pos, str, N - 1);
+			m_pos += N - 1;
 			return *this;
 		}
 	};
 
+	// separators and indentation for writer and reformat, made from PrettyOption. (not pretty -> minified)
+	class Layout {
+	private:
+		std::string line; // newline + indent_char * 256
+		uint64_t nl_size = 0;
+		uint64_t indent = 0;
+	public:
+		bool pretty = false;
+		bool compact_scalar_array = false;
+		bool newline_at_end = false;
+	public:
+		explicit Layout(bool pretty) {
+			if (pretty) {
+				init(PrettyOption());
+			}
+		}
+		explicit Layout(const PrettyOption& option) {
+			init(option);
+		}
+	private:
+		void init(const PrettyOption& option) {
+			pretty = true;
+			compact_scalar_array = option.compact_scalar_array;
+			newline_at_end = option.newline_at_end;
+			indent = option.indent;
+
+			line = option.crlf ? "\r\n" : "\n";
+			nl_size = line.size();
+			line.append(256, option.indent_char);
+		}
+	public:
+		// newline and indent for `depth`, from the precomputed run.
+		claujson_inline void newline(StrStream& stream, uint64_t depth) const {
+			if (!pretty) {
+				return;
+			}
+			uint64_t n = nl_size + depth * indent;
+			if (n <= line.size()) {
+				stream.add_n(line.data(), n);
+				return;
+			}
+			// very deep.
+			stream.add_n(line.data(), line.size());
+			n -= line.size();
+			while (n > 0) {
+				const uint64_t m = std::min<uint64_t>(n, line.size() - nl_size);
+				stream.add_n(line.data() + nl_size, m);
+				n -= m;
+			}
+		}
+		claujson_inline void colon(StrStream& stream) const {
+			if (pretty) {
+				stream.add_lit(": ");
+			}
+			else {
+				stream.add_char(':');
+			}
+		}
+		// in compact array.
+		claujson_inline void compact_comma(StrStream& stream) const {
+			if (pretty) {
+				stream.add_lit(", ");
+			}
+			else {
+				stream.add_char(',');
+			}
+		}
+		// end of document.
+		void end(StrStream& stream) const {
+			if (pretty && newline_at_end) {
+				stream.add_n(line.data(), nl_size);
+			}
+		}
+	};
+
 	class LoadData2 {
 	private:
 		ThreadPool* pool;
@@ -1072,7 +1314,7 @@ namespace claujson {
 
 		 }
 
-		 uint64_t Size2(const _Value& root) {
+		 static uint64_t Size2(const _Value& root) {
 			if (!root.as_array() && !root.as_object()) {
 				return 0;
 			}
@@ -1436,67 +1678,175 @@ namespace claujson {
 			return pos;
 		}
 
-		 int Merge(StructuredPtr next, StructuredPtr ut, StructuredPtr* ut_next)
-		{
+		// items of one level of a chunk (source) are moved to target, from offset.
+		struct MergeJob {
+			StructuredPtr target;
+			StructuredPtr source;
+			uint64_t offset;
+		};
 
-			// check!!
-			while (ut.get_data_size() >= 1
-				&& ut.get_value_list(0).is_structured() && (ut.get_value_list(0).is_virtual()))
-			{
-				ut = StructuredPtr(ut.get_value_list(0));
+		// target is array, object or root(PartialJson, as array).
+		static bool mergeable(StructuredPtr target, StructuredPtr source) {
+			if (source.is_partial_json()) {
+				if (target.is_object()) {
+					return source.pj->arr_vec.empty();
+				}
+				return source.pj->obj_data.empty();
+			}
+			if (target.is_object()) {
+				return source.is_object();
 			}
+			return source.is_array();
+		}
 
-			while (true) {
+		static uint64_t target_size(StructuredPtr target) {
+			if (target.is_object()) {
+				return target.obj->obj_data.size();
+			}
+			if (target.is_array()) {
+				return target.arr->arr_vec.size();
+			}
+			return target.pj->arr_vec.size();
+		}
 
-				class StructuredPtr _ut = ut;
-				class StructuredPtr _next = next;
+		static void target_resize(StructuredPtr target, uint64_t len) {
+			if (target.is_object()) {
+				target.obj->obj_data.resize(len);
+			}
+			else if (target.is_array()) {
+				target.arr->arr_vec.resize(len);
+			}
+			else {
+				target.pj->arr_vec.resize(len);
+			}
+		}
 
-				//log << warn  << "chk\n";
-				if (ut_next && _ut == *ut_next) { // chk_next_ut
-					*ut_next = _next;
+		// virtual first child is lower level, it is not moved.
+		static uint64_t source_begin(StructuredPtr source) {
+			if (source.is_partial_json()) { // virtualJson is not in arr_vec or obj_data.
+				return 0;
+			}
+			if (source.get_data_size() > 0 && source.get_value_list(0).is_structured() && source.get_value_list(0).is_virtual()) {
+				return 1;
+			}
+			return 0;
+		}
 
-					//log << info << "chked in merge...\n"; // special case!
-				}
+		static uint64_t source_count(StructuredPtr source) {
+			if (source.is_partial_json()) {
+				return source.pj->arr_vec.size() + source.pj->obj_data.size();
+			}
+			return source.get_data_size() - source_begin(source);
+		}
 
-				if (_next.is_array() && _ut.is_object()) {
-					ERROR("Error in Merge, next is array but child? is object");
+		static void set_parent(_Value& x, StructuredPtr parent) {
+			if (x.is_array()) {
+				x.as_array()->set_parent(parent);
+			}
+			else if (x.is_object()) {
+				x.as_object()->set_parent(parent);
+			}
+		}
+
+		static void move_items(const MergeJob& job, bool parent) {
+			StructuredPtr target = job.target;
+			StructuredPtr source = job.source;
+			uint64_t k = job.offset;
+
+			if (target.is_object()) {
+				auto& dest = target.obj->obj_data;
+				auto& src = source.is_partial_json() ? source.pj->obj_data : source.obj->obj_data;
+
+				for (uint64_t i = source_begin(source); i < src.size(); ++i) {
+					if (parent) {
+						set_parent(src[i].second, target);
+					}
+					dest[k++] = std::move(src[i]);
 				}
-				if (_next.is_object() && _ut.is_array()) {
-					ERROR("Error in Merge, next is object but child? is array");
+			}
+			else {
+				auto& dest = target.is_array() ? target.arr->arr_vec : target.pj->arr_vec;
+				auto& src = source.is_partial_json() ? source.pj->arr_vec : source.arr->arr_vec;
+
+				for (uint64_t i = source_begin(source); i < src.size(); ++i) {
+					if (parent) {
+						set_parent(src[i], target);
+					}
+					dest[k++] = std::move(src[i]);
 				}
+			}
+		}
 
-				int start_offset = 0;
-				if (_ut.get_data_size() > 0 && _ut.get_value_list(0).is_structured() && _ut.get_value_list(0).is_virtual()) {
-					++start_offset;
+		// __global[i] is chunk i, [virtual_n [virtual_n-1 [ ... [virtual_1 ...] ...] ...] ...], open[i] is open containers at end of it.
+		//  virtual_1 goes to the last open container of chunks before, virtual_2 to its parent, ..., __global[i] to the end.
+		//  targets are found with a stack of open containers (only pointers, fast),
+		//  then all levels of all chunks are moved and re-parented in one parallel round.
+		void Merge(StructuredPtr root, std_vector<StructuredPtr>& __global, std_vector<std_vector<StructuredPtr>>& open, bool parent) {
+			std_vector<MergeJob> jobs;
+			std_vector<std::pair<StructuredPtr, uint64_t>> targets; // with new size.
+
+			std_vector<StructuredPtr> path; // open containers, path[0] is root.
+			std_vector<uint64_t> path_size;
+			std_vector<StructuredPtr> chain;
+
+			path.push_back(root);
+			path_size.push_back(target_size(root));
+
+			for (uint64_t i = 0; i < __global.size(); ++i) {
+				if (__global[i].get_data_size() == 0) { // only ','
+					continue;
 				}
 
-				_next.MergeWith(_ut, start_offset);
+				chain.clear();
+				StructuredPtr ut = __global[i];
+				chain.push_back(ut);
+				while (ut.get_data_size() >= 1
+					&& ut.get_value_list(0).is_structured() && (ut.get_value_list(0).is_virtual())) {
+					ut = StructuredPtr(ut.get_value_list(0));
+					chain.push_back(ut);
+				}
 
-				if (_ut.get_data_size() > 0 && _ut.get_value_list(0).is_structured() && _ut.get_value_list(0).is_virtual()) {
-					clean(_ut.get_value_list(0));
+				if (chain.size() > path.size()) { // closes more than opened.
+					log << warn << "not valid file3\n";
+					throw 3;
 				}
 
-				_ut.clear();
+				for (uint64_t k = 0; k < chain.size(); ++k) {
+					StructuredPtr source = chain[chain.size() - 1 - k];
+					const uint64_t d = path.size() - 1 - k;
 
-				ut = ut.get_parent();
-				next = next.get_parent();
+					if (!mergeable(path[d], source)) {
+						ERROR("Error in Merge, next and child? are not same type");
+					}
 
+					jobs.push_back({ path[d], source, path_size[d] });
+					path_size[d] += source_count(source);
+				}
 
-				if (next && ut) {
-					//
+				for (uint64_t k = 1; k < chain.size(); ++k) {
+					targets.push_back({ path.back(), path_size.back() });
+					path.pop_back();
+					path_size.pop_back();
 				}
-				else {
-					// right_depth > left_depth
-					if (!next && ut) {
-						return -1;
-					}
-					else if (next && !ut) {
-						return 1;
-					}
 
-					return 0;
+				for (auto& x : open[i]) {
+					path.push_back(x);
+					path_size.push_back(target_size(x));
 				}
 			}
+
+			if (path.size() != 1) { // not closed.
+				log << warn << "not valid file2\n";
+				throw 2;
+			}
+			targets.push_back({ path[0], path_size[0] });
+
+			pool->parallel_for(0, targets.size(), 64, [&](size_t i) {
+				target_resize(targets[i].first, targets[i].second);
+			});
+			pool->parallel_for(0, jobs.size(), 1, [&](size_t i) {
+				move_items(jobs[i], parent);
+			});
 		}
 
 		 int Merge2(StructuredPtr next, StructuredPtr ut, StructuredPtr* ut_next, int& op)
@@ -1582,9 +1932,9 @@ namespace claujson {
 			_simdjson::internal::dom_parser_implementation* imple,
 			int64_t token_arr_start, uint64_t token_arr_len, StructuredPtr _global,
 			int start_state, int last_state, // this line : now not used..
-			class StructuredPtr* next, uint64_t* count_vec, 
+			std_vector<StructuredPtr>* open, uint64_t* count_vec, 
 
-			 int* err, uint64_t no)
+			 int* err, uint64_t no, bool parent)
 		{
 			try {
 				if (token_arr_len <= 0) {
@@ -1593,13 +1943,12 @@ namespace claujson {
 				
 				// token_arr_len >= 1
 
-				uint64_t left_no = token_arr_start;
-
 				class StructuredPtr global = _global;
 
 				uint64_t braceNum = 0;
 
-				StructuredPtr nowUT = global; // use get_parent(), not std_vector<StructuredPtr>
+				StructuredPtr nowUT = global;
+				std_vector<StructuredPtr>& stack = *open; // open containers, not get_parent().
 
 				TokenTemp key;
 
@@ -1655,12 +2004,12 @@ namespace claujson {
 
 						if (key.is_key) {
 							nowUT.add_user_type(key.buf_idx, key.next_buf_idx, buf,
-								type == '{' ? _ValueType::OBJECT : _ValueType::ARRAY, key.token_idx
+								type == '{' ? _ValueType::OBJECT : _ValueType::ARRAY, key.token_idx, parent
 							); // object vs array
 							key.is_key = false;
 						}
 						else {
-							nowUT.add_user_type(type == '{' ? _ValueType::OBJECT : _ValueType::ARRAY
+							nowUT.add_user_type(type == '{' ? _ValueType::OBJECT : _ValueType::ARRAY, parent
 							);
 						}
 
@@ -1669,8 +2018,9 @@ namespace claujson {
 						braceNum++;
 
 						/// initial new nestedUT.
+						stack.push_back(pTemp);
 						nowUT = pTemp;
-						nowUT.reserve_data_list(count_vec[left_no++]);
+						nowUT.reserve_data_list(count_vec[token_arr_start + i]);
 
 					}
 					break;
@@ -1688,52 +2038,42 @@ namespace claujson {
 							else {
 								_ut = Array::MakeVirtual();
 							}
+							// nowUT is global, (PartialJson) its items go to _ut, parents are set in Merge.
+							PartialJson* pj = nowUT.pj;
 							StructuredPtr ut = _ut;
-							uint64_t len = nowUT.get_data_size();
-							ut.reserve_data_list(len);
 
-							if (len > 0 && nowUT.get_value_list(0).is_virtual()) {
-								if (ut.is_array()) {
-									ut.add_array_element(std::move(nowUT.get_value_list(0)));
+							if (ut.is_array()) {
+								if (!pj->obj_data.empty()) {
+									ERROR("Error in __LoadData, object is closed with ]");
 								}
-								else { // ut->is_object()
-									ut.add_object_element(_Value(), std::move(nowUT.get_value_list(0)));
+								auto& vec = ut.arr->arr_vec;
+								vec.reserve(pj->get_data_size());
+								if (pj->virtualJson.is_structured()) {
+									vec.push_back(std::move(pj->virtualJson));
 								}
-								--len;
+								vec.insert(vec.end(), std::make_move_iterator(pj->arr_vec.begin()), std::make_move_iterator(pj->arr_vec.end()));
 							}
-
-							for (uint64_t i = 0; i < len; ++i) {
-								if (nowUT.get_value_list(i).is_structured()) {
-									if (ut.is_array()) {
-										ut.add_array_element(std::move(nowUT.get_value_list(i)));
-									}
-									else { // ut->is_object()
-										if (nowUT.get_value_list(i).is_virtual()) {
-											ut.add_object_element(_Value(), std::move(nowUT.get_value_list(i)));
-										}
-										else {
-											ut.add_object_element(std::move(nowUT.get_key_list(i)), std::move(nowUT.get_value_list(i)));
-										}
-									}
+							else {
+								if (!pj->arr_vec.empty()) {
+									ERROR("Error in __LoadData, array is closed with }");
 								}
-								else {
-									if (ut.is_object()) {
-										ut.add_object_element(std::move(nowUT.get_key_list(i)),
-											std::move(nowUT.get_value_list(i)));
-									}
-									else {
-										ut.add_array_element(std::move(nowUT.get_value_list(i)));
-									}
+								auto& vec = ut.obj->obj_data;
+								vec.reserve(pj->get_data_size());
+								if (pj->virtualJson.is_structured()) {
+									vec.emplace_back(_Value(), std::move(pj->virtualJson));
 								}
+								vec.insert(vec.end(), std::make_move_iterator(pj->obj_data.begin()), std::make_move_iterator(pj->obj_data.end()));
 							}
 
-							nowUT.clear();
-							nowUT.add_array_element(std::move(_ut)); // this nowUT is always PartialJson?
+							pj->clear();
+							pj->virtualJson = std::move(_ut);
+
 						}
 						else {
 							braceNum--;
 
-							nowUT = nowUT.get_parent();
+							stack.pop_back();
+							nowUT = stack.empty() ? global : stack.back();
 						}
 					}
 					break;
@@ -1741,10 +2081,6 @@ namespace claujson {
 					}
 				}
 
-				if (next) {
-					*next = nowUT;
-				}
-
 				return true;
 			}
 			catch (const char* _err) {
@@ -1761,28 +2097,12 @@ namespace claujson {
 			}
 		}
 
-		 int64_t FindDivisionPlace(char* buf, _simdjson::internal::dom_parser_implementation* imple, int64_t start, int64_t last)
-		{
-			for (int64_t a = start; a <= last; ++a) {
-				auto& x = imple->structural_indexes[a]; //  token_arr[a];
-				const _simdjson::internal::tape_type type = (_simdjson::internal::tape_type)buf[x];
-
-				switch ((int)type) {
-				case ',':
-					return a ;
-				default:
-					break;
-				}
-			}
-			return -1;
-		}
-		 
 		 bool _LoadData(_Value& global, char* buf, uint64_t buf_len,
 
-			_simdjson::internal::dom_parser_implementation* imple, int64_t& length,
+			_simdjson::internal::dom_parser_implementation* imple,
 			std_vector<int64_t>& start, uint64_t* count_vec,
 
-			 uint64_t parse_num) // first, strVec.empty() must be true!!
+			 bool parent) // first, strVec.empty() must be true!!
 		{	
 			StructuredPtr _global = (new PartialJson());
 			std_vector<StructuredPtr> __global;
@@ -1790,79 +2110,30 @@ namespace claujson {
 			try {
 				 
 				{
-					uint64_t pivot_num = parse_num;
-					
 					{ 
-					std::set<int64_t> _pivots;
-					std_vector<int64_t> pivots;
-					//const int64_t num = token_arr_len; //
-
-					if (pivot_num > 0) {
-						std_vector<int64_t> pivot;
-						pivots.reserve(pivot_num + 1);
-						pivot.reserve(pivot_num);
-
-						pivot.push_back(start[0]);
-
-						for (uint64_t i = 1; i < parse_num; ++i) {
-							pivot.push_back(FindDivisionPlace(buf, imple, start[i], start[i + 1] - 1));
-						}
-
-						for (uint64_t i = 0; i < pivot.size(); ++i) {
-							if (pivot[i] != -1) {
-								_pivots.insert(pivot[i]);
-							}
-						}
-
-						for (auto& x : _pivots) {
-							pivots.push_back(x);
-						}
-
-						pivots.push_back(length);
-					}
-					else {
-						pivots.push_back(start[0]);
-						pivots.push_back(length);
-					}
+					// start[i] : `,` chosen by Validate (or 0), start.back() : length.
+					const std_vector<int64_t>& pivots = start;
 
-					std_vector<StructuredPtr> next(pivots.size() - 1);
+					std_vector<std_vector<StructuredPtr>> open(pivots.size() - 1);
 					{
 						__global = std_vector<StructuredPtr>(pivots.size() - 1);
 						for (uint64_t i = 0; i < __global.size(); ++i) {
 							__global[i] = (new PartialJson());
 						}
 
-						std_vector<std::future<bool>> result(pivots.size() - 1);
 						std_vector<int> err(pivots.size() - 1, 0);
 
-						{
-							int64_t idx = pivots[1] - pivots[0];
-							int64_t _token_arr_len = idx;
-
-
-							result[0] = pool->enqueue(__LoadData, (buf), buf_len, (imple), start[0], _token_arr_len, (__global[0]), 0, 0,
-								&next[0], count_vec,
-
-								&err[0], 0);
-						}
-
 						auto a = std::chrono::steady_clock::now();
 
-						for (uint64_t i = 1; i < pivots.size() - 1; ++i) {
+						// fork-join, this thread takes part. (no blocking wait, so it can be called from a task of the pool)
+						pool->parallel_for(0, pivots.size() - 1, 1, [&](uint64_t i) {
 							int64_t _token_arr_len = pivots[i + 1] - pivots[i];
 
-							result[i] = pool->enqueue(__LoadData, (buf), buf_len, (imple), pivots[i], _token_arr_len, (__global[i]), 0, 0,
-								&next[i], count_vec,
-
-								& err[i], i);
-
-						}
-
+							__LoadData(buf, buf_len, imple, pivots[i], _token_arr_len, __global[i], 0, 0,
+								&open[i], count_vec,
 
-						// wait
-						for (uint64_t i = 0; i < result.size(); ++i) {
-							result[i].get();
-						}
+								&err[i], i, parent);
+						});
 
 						auto b = std::chrono::steady_clock::now();
 						auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
@@ -1878,94 +2149,7 @@ namespace claujson {
 							}
 						}
 
-						// Merge
-
-						{
-							int i = 0;
-							std_vector<int> chk(parse_num, 0);
-							auto x = next.begin();
-							auto y = __global.begin();
-							while (true) {
-								if ((y)->get_data_size() == 0) {
-									chk[i] = 1;
-								}
-
-								++x;
-								++y;
-								++i;
-
-								if (x == next.end()) {
-									break;
-								}
-							}
-
-							uint64_t start = 0;
-							uint64_t last = pivots.size() - 1 - 1;
-
-							for (uint64_t i = 0; i < pivots.size() - 1; ++i) {
-								if (chk[i] == 0) {
-									start = i;
-									break;
-								}
-							}
-
-							for (uint64_t i = pivots.size() - 1; i > 0; --i) {
-								if (chk[i - 1] == 0) {
-									last = i - 1;
-									break;
-								}
-							}
-
-							if (__global[start].get_data_size() > 0 && __global[start].get_value_list(0).is_structured()
-								&& (__global[start].get_value_list(0).is_virtual())) {
-								log << warn << "not valid file1\n";
-								throw 1;
-							}
-							if (next[last] && !(next[last].get_parent() == nullptr)) {
-								log << warn << "not valid file2\n";
-								throw 2;
-							}
-
-
-							int err = Merge(_global, __global[start], &next[start]);
-							if (-1 == err || (pivots.size() == 0 && 1 == err)) {
-								log << warn << "not valid file3\n";
-								throw 3;
-							}
-
-							for (uint64_t i = start + 1; i <= last; ++i) {
-
-								if (chk[i]) {
-									continue;
-								}
-
-								// linearly merge and error check...
-								uint64_t before = i - 1;
-								for (uint64_t k = i; k > 0; --k) {
-									if (chk[k - 1] == 0) {
-										before = k - 1;
-										break;
-									}
-								}
-
-								int err = Merge(next[before], __global[i], &next[i]);
-
-								if (-1 == err) {
-									log << warn << "chk " << i << " " << __global.size() << "\n";
-									log << warn << "not valid file4\n";
-									throw 4;
-								}
-								else if (i == last && 1 == err) {
-									log << warn << "not valid file5\n";
-									throw 5;
-								}
-							}
-						}
-						//catch (...) {
-							//throw "in Merge, error";
-						//	return false;
-						//}
-						//
+						Merge(_global, __global, open, parent);
 
 						if (_global.get_data_size() > 1) { // bug fix..
 							log << warn << "not valid file6\n";
@@ -2056,40 +2240,538 @@ namespace claujson {
 		 bool parse(_Value& global, char* buf, uint64_t buf_len,
 
 			_simdjson::internal::dom_parser_implementation* imple,
-			int64_t length, std_vector<int64_t>& start, uint64_t* count_vec, 
+			std_vector<int64_t>& start, uint64_t* count_vec, 
 
-			 uint64_t thr_num) {
+			 bool parent) {
 
-			return _LoadData(global, buf, buf_len, imple, length, start, count_vec, 
+			return _LoadData(global, buf, buf_len, imple, start, count_vec, 
 
-				thr_num);
+				parent);
 		}
 
 	private:
-		//                         
-		 static void _write(StrStream& stream, const _Value& data, std_vector<StructuredPtr>& chk_list, const int depth, bool pretty);
-		 static void _write(StrStream& stream, const _Value& data, const int depth, bool pretty);
+		// value at `token` is built later into slot `idx` of `target`. (parse with Projection)
+		struct ProjectJob {
+			StructuredPtr target;
+			uint64_t idx;
+			uint64_t token;
+		};
 
-		 static void write_(StrStream& stream, const _Value& global, StructuredPtr temp, bool pretty, bool hint);
+		// token after the value at `i`.
+		static uint64_t project_skip(const char* buf, const uint32_t* idx, const uint64_t* jump, uint64_t i) {
+			const char ch = buf[idx[i]];
+			return ch == '[' || ch == '{' ? jump[i] + 1 : i + 1;
+		}
 
-	public:
-		// test?... just Data has one element 
-		 void write(const std::string& fileName, const _Value& global, bool pretty, bool hint = false);
+		// arrays and objects on the paths from token `i`, values at leaves are jobs. others are skipped with jump.
+		//  on fail, `out` can have a part of tree.
+		static bool project_walk(char* buf, const _simdjson::internal::dom_parser_implementation* imple, const uint64_t* jump,
+			const Projection& projection, const std_vector<uint64_t>& state, uint64_t i, _Value& out, std_vector<ProjectJob>& jobs, bool parent) {
+			const uint32_t* idx = imple->structural_indexes.get();
+			const char ch = buf[idx[i]];
 
-		 void write(std::ostream& stream, const _Value& data, bool pretty);
+			if (ch != '[' && ch != '{') {
+				return true; // path goes on, but not array or object.
+			}
 
-		 std::string write_to_str(const _Value& data, bool pretty);
-		 std::string write_to_str2(const _Value& data, bool pretty);
+			bool named = false; // need names of items?
+			for (auto x : state) {
+				named = named || !projection.nodes[x].child.empty();
+			}
 
-		 void write_parallel(const std::string& fileName, _Value& j, uint64_t thr_num, bool pretty);
-		 void write_parallel2(const std::string& fileName, const _Value& j, uint64_t thr_num, bool pretty);
+			std_vector<uint64_t> next;
+			bool leaf = false;
 
-	};
+			if (ch == '[') {
+				Array* arr = new (std::nothrow) Array();
+				if (!arr) {
+					return false;
+				}
+				out = _Value(arr);
 
-	claujson_inline void _write_string(StrStream& stream, char ch) {
-		switch (ch) {
-		case '\\':
-			stream.add_2("\\\\");
+				uint64_t k = 0;
+				for (uint64_t j = i + 1; buf[idx[j]] != ']'; ++k) {
+					next.clear();
+					projection.step(state, named ? StringView(std::to_string(k)) : StringView(), named, next, leaf);
+
+					if (!next.empty()) {
+						_Value v;
+						if (leaf) {
+							arr->arr_vec.push_back(_Value(nullptr));
+							jobs.push_back({ StructuredPtr(arr), arr->arr_vec.size() - 1, j });
+						}
+						else if (!project_walk(buf, imple, jump, projection, next, j, v, jobs, parent)) {
+							claujson::clean(v);
+							return false;
+						}
+						else if (v.is_structured()) {
+							if (parent) {
+								set_parent(v, arr);
+							}
+							arr->arr_vec.push_back(std::move(v));
+						}
+					}
+
+					j = project_skip(buf, idx, jump, j);
+					if (buf[idx[j]] == ',') {
+						++j;
+					}
+				}
+			}
+			else {
+				Object* obj = new (std::nothrow) Object();
+				if (!obj) {
+					return false;
+				}
+				out = _Value(obj);
+
+				for (uint64_t j = i + 1; buf[idx[j]] != '}';) {
+					// j : key, j + 1 : `:`, j + 2 : value
+					_Value key;
+					bool err = false;
+					Convert(key, idx[j], idx[j + 1], true, buf, j, err);
+					if (err) {
+						return false;
+					}
+
+					next.clear();
+					projection.step(state, StringView(key.get_string().data(), key.get_string().size()), true, next, leaf);
+
+					if (!next.empty()) {
+						_Value v;
+						if (leaf) {
+							obj->obj_data.emplace_back(std::move(key), _Value(nullptr));
+							jobs.push_back({ StructuredPtr(obj), obj->obj_data.size() - 1, j + 2 });
+						}
+						else if (!project_walk(buf, imple, jump, projection, next, j + 2, v, jobs, parent)) {
+							claujson::clean(v);
+							return false;
+						}
+						else if (v.is_structured()) {
+							if (parent) {
+								set_parent(v, obj);
+							}
+							obj->obj_data.emplace_back(std::move(key), std::move(v));
+						}
+					}
+
+					j = project_skip(buf, idx, jump, j + 2);
+					if (buf[idx[j]] == ',') {
+						++j;
+					}
+				}
+			}
+			return true;
+		}
+
+		// one value at `token` into `out`, (no parent)
+		static bool build_value(char* buf, uint64_t buf_len, _simdjson::internal::dom_parser_implementation* imple, const uint64_t* jump,
+			uint64_t token, _Value& out, uint64_t* count_vec, bool parent) {
+			const uint32_t* idx = imple->structural_indexes.get();
+			const char ch = buf[idx[token]];
+
+			if (ch != '[' && ch != '{') {
+				bool err = false;
+				const uint64_t next_buf_idx = token + 1 < imple->n_structural_indexes ? idx[token + 1] : buf_len;
+				Convert(out, idx[token], next_buf_idx, false, buf, token, err);
+				return !err;
+			}
+
+			StructuredPtr R = new (std::nothrow) PartialJson();
+			if (!R) {
+				return false;
+			}
+			std_vector<StructuredPtr> open;
+			int err = 0;
+
+			bool ok = __LoadData(buf, buf_len, imple, token, jump[token] + 1 - token, R, 0, 0, &open, count_vec, &err, 0, parent)
+				&& err == 0 && open.empty() && R.get_data_size() == 1;
+
+			if (ok) {
+				out = std::move(R.get_value_list(0));
+				set_parent(out, nullptr);
+			}
+			R.Delete();
+			return ok;
+		}
+
+		static bool project_job(char* buf, uint64_t buf_len, _simdjson::internal::dom_parser_implementation* imple, const uint64_t* jump,
+			const ProjectJob& job, uint64_t* count_vec, bool parent) {
+			StructuredPtr target = job.target;
+			_Value& slot = target.is_array() ? target.arr->arr_vec[job.idx] : target.obj->obj_data[job.idx].second;
+
+			if (!build_value(buf, buf_len, imple, jump, job.token, slot, count_vec, parent)) {
+				return false;
+			}
+			if (parent) {
+				set_parent(slot, target);
+			}
+			return true;
+		}
+
+	public:
+		// build only paths in `projection`, jump[i] : matching `]` or `}` of token i. one job per selected value.
+		bool project(_Value& global, char* buf, uint64_t buf_len,
+			_simdjson::internal::dom_parser_implementation* imple, const uint64_t* jump, uint64_t* count_vec,
+			const Projection& projection, bool parent) {
+
+			const std_vector<uint64_t> state(1, 0);
+			std_vector<ProjectJob> jobs;
+			_Value root;
+
+			if (!project_walk(buf, imple, jump, projection, state, 0, root, jobs, parent)) {
+				claujson::clean(root);
+				return false;
+			}
+
+			std_vector<int> result(jobs.size(), 0);
+
+			pool->parallel_for(0, jobs.size(), 16, [&](uint64_t k) {
+				result[k] = project_job(buf, buf_len, imple, jump, jobs[k], count_vec, parent);
+			});
+
+			for (uint64_t k = 0; k < jobs.size(); ++k) {
+				if (!result[k]) {
+					log << warn << "projection error at token " << jobs[k].token << "\n";
+					claujson::clean(root);
+					return false;
+				}
+			}
+
+			global = std::move(root);
+			return true;
+		}
+
+		// elements of root array, in windows of about `window` tokens. next window is built while on_element runs.
+		//  given : number of elements given to on_element.
+		bool stream(char* buf, uint64_t buf_len,
+			_simdjson::internal::dom_parser_implementation* imple, const uint64_t* jump, uint64_t* count_vec, uint64_t window,
+			const std::function<bool(uint64_t, _Value&)>& on_element, bool parent, uint64_t& given) {
+			const uint32_t* idx = imple->structural_indexes.get();
+			uint64_t j = 1; // next element.
+
+			auto next_window = [&](std_vector<uint64_t>& tokens) {
+				tokens.clear();
+				const uint64_t from = j;
+				while (buf[idx[j]] != ']' && (tokens.empty() || j - from < window)) {
+					tokens.push_back(j);
+					j = project_skip(buf, idx, jump, j);
+					if (buf[idx[j]] == ',') {
+						++j;
+					}
+				}
+			};
+			auto build = [&](const std_vector<uint64_t>& tokens, std_vector<_Value>& values, std_vector<int>& result) {
+				values.resize(tokens.size());
+				result.assign(tokens.size(), 0);
+				pool->parallel_for(0, tokens.size(), 1, [&](uint64_t k) {
+					result[k] = build_value(buf, buf_len, imple, jump, tokens[k], values[k], count_vec, parent);
+				});
+			};
+			auto clean_all = [](std_vector<_Value>& values) {
+				for (auto& x : values) {
+					claujson::clean(x);
+				}
+				values.clear();
+			};
+
+			std_vector<uint64_t> tokens[2];
+			std_vector<_Value> values[2];
+			std_vector<int> result[2];
+			uint64_t now = 0;
+			bool ok = true, stop = false;
+
+			given = 0;
+			next_window(tokens[0]);
+			build(tokens[0], values[0], result[0]);
+
+			while (!tokens[now].empty()) {
+				const uint64_t other = 1 - now;
+				next_window(tokens[other]);
+
+				// next window is built while this one is given, this thread takes part. (no blocking wait)
+				try {
+					pool->parallel_for(0, 2, 1, [&](uint64_t part) {
+						if (part == 1) {
+							build(tokens[other], values[other], result[other]);
+							return;
+						}
+						for (uint64_t k = 0; k < values[now].size() && ok && !stop; ++k) {
+							if (!result[now][k]) {
+								log << warn << "stream error at token " << tokens[now][k] << "\n";
+								ok = false;
+								break;
+							}
+							stop = !on_element(given++, values[now][k]);
+						}
+					});
+				}
+				catch (...) {
+					clean_all(values[now]);
+					clean_all(values[other]);
+					throw;
+				}
+				clean_all(values[now]);
+
+				if (!ok || stop) {
+					clean_all(values[other]);
+					break;
+				}
+				now = other;
+			}
+			return ok;
+		}
+
+		// values at `path` under x, from : states at x. scratch[depth] is for states of children. (size > depth of path)
+		static void visit_dfs(const _Value& x, const Projection& path, const std_vector<uint64_t>& from, uint64_t part,
+			const std::function<void(uint64_t, const _Value&)>& f, std_vector<std_vector<uint64_t>>& scratch, uint64_t depth) {
+			std_vector<uint64_t>& next = scratch[depth];
+
+			bool named = false;
+			for (auto s : from) {
+				named = named || !path.nodes[s].child.empty();
+			}
+
+			const uint64_t n = x.is_array() ? x.as_array()->get_data_size() : x.as_object()->get_data_size();
+			for (uint64_t i = 0; i < n; ++i) {
+				bool leaf = false;
+				next.clear();
+				if (x.is_array()) {
+					path.step(from, named ? StringView(std::to_string(i)) : StringView(), named, next, leaf);
+				}
+				else {
+					const _Value& key = x.as_object()->get_key_list(i);
+					path.step(from, StringView(key.get_string().data(), key.get_string().size()), true, next, leaf);
+				}
+				if (next.empty()) {
+					continue;
+				}
+				const _Value& y = x.is_array() ? x.as_array()->get_value_list(i) : x.as_object()->get_value_list(i);
+				if (leaf) {
+					f(part, y);
+				}
+				else if (y.is_structured()) {
+					visit_dfs(y, path, next, part, f, scratch, depth + 1);
+				}
+			}
+		}
+
+		// expands levels until there are enough items, (values at path and subtrees, in document order)
+		//  then items are split into parts by position, so parts are also in document order.
+		static void visit(ThreadPool* pool, const _Value& root, const Projection& path, uint64_t parts,
+			const std::function<void(uint64_t, const _Value&)>& f) {
+			if (path.all()) {
+				f(0, root);
+				return;
+			}
+			if (!root.is_structured() || parts == 0) {
+				return;
+			}
+
+			struct Item {
+				const _Value* x;
+				uint64_t begin, end; // in states, begin == end -> x is a value at path.
+			};
+			std_vector<Item> now{ { &root, 0, 1 } }, next;
+			std_vector<uint64_t> states{ 0 }, next_states, temp;
+			bool subtree = true; // some item is not a value at path.
+
+			while (subtree && now.size() < parts * 4) {
+				next.clear();
+				next_states.clear();
+				subtree = false;
+
+				for (auto& item : now) {
+					if (item.begin == item.end) {
+						next.push_back(item);
+						continue;
+					}
+					const _Value& x = *item.x;
+					const std_vector<uint64_t> from(states.begin() + item.begin, states.begin() + item.end);
+					bool named = false;
+					for (auto s : from) {
+						named = named || !path.nodes[s].child.empty();
+					}
+
+					const uint64_t n = x.is_array() ? x.as_array()->get_data_size() : x.as_object()->get_data_size();
+					for (uint64_t i = 0; i < n; ++i) {
+						bool leaf = false;
+						temp.clear();
+						if (x.is_array()) {
+							path.step(from, named ? StringView(std::to_string(i)) : StringView(), named, temp, leaf);
+						}
+						else {
+							const _Value& key = x.as_object()->get_key_list(i);
+							path.step(from, StringView(key.get_string().data(), key.get_string().size()), true, temp, leaf);
+						}
+						if (temp.empty()) {
+							continue;
+						}
+						const _Value& y = x.is_array() ? x.as_array()->get_value_list(i) : x.as_object()->get_value_list(i);
+						if (leaf) {
+							next.push_back({ &y, 0, 0 });
+						}
+						else if (y.is_structured()) {
+							next.push_back({ &y, next_states.size(), next_states.size() + temp.size() });
+							next_states.insert(next_states.end(), temp.begin(), temp.end());
+							subtree = true;
+						}
+					}
+				}
+				now.swap(next);
+				states.swap(next_states);
+			}
+
+			pool->parallel_for(0, parts, 1, [&](uint64_t part) {
+				const uint64_t a = now.size() * part / parts;
+				const uint64_t b = now.size() * (part + 1) / parts;
+				std_vector<std_vector<uint64_t>> scratch(path.nodes.size() + 1);
+				std_vector<uint64_t> from;
+				for (uint64_t i = a; i < b; ++i) {
+					if (now[i].begin == now[i].end) {
+						f(part, *now[i].x);
+						continue;
+					}
+					from.assign(states.begin() + now[i].begin, states.begin() + now[i].end);
+					visit_dfs(*now[i].x, path, from, part, f, scratch, 0);
+				}
+			});
+		}
+
+		// open arrays and objects at start[i] (a `,`) for i >= 1. start is sorted, so one walk for all.
+		static void sax_paths(char* buf, const _simdjson::internal::dom_parser_implementation* imple, const uint64_t* jump,
+			const std_vector<int64_t>& start, uint64_t parts, std_vector<std_vector<SaxLevel>>& path) {
+			const uint32_t* idx = imple->structural_indexes.get();
+			struct Frame {
+				uint64_t c; // `[` or `{`
+				uint64_t item; // token of item.
+				uint64_t k;
+			};
+			std_vector<Frame> stack{ { 0, 1, 0 } };
+
+			for (uint64_t i = 1; i < parts; ++i) {
+				const uint64_t s = start[i];
+				while (stack.size() > 1 && jump[stack.back().c] < s) {
+					stack.pop_back();
+				}
+				for (;;) {
+					Frame& f = stack.back();
+					const bool in_object = buf[idx[f.c]] == '{';
+					const uint64_t v = in_object ? f.item + 2 : f.item; // value of item.
+					const uint64_t e = project_skip(buf, idx, jump, v);
+					if (s == e) { // `,` after item k.
+						break;
+					}
+					if (s < e) { // in item k.
+						stack.push_back({ v, v + 1, 0 });
+						continue;
+					}
+					f.item = e + 1;
+					++f.k;
+				}
+
+				auto& out = path[i];
+				out.resize(stack.size());
+				for (uint64_t d = 0; d < stack.size(); ++d) {
+					const Frame& f = stack[d];
+					out[d].is_object = buf[idx[f.c]] == '{';
+					out[d].index = d + 1 < stack.size() ? f.k : f.k + 1;
+					out[d].key.clear();
+					if (out[d].is_object && d + 1 < stack.size()) {
+						_Value key;
+						bool err = false;
+						Convert(key, idx[f.item], idx[f.item + 1], true, buf, f.item, err);
+						if (!err) {
+							out[d].key.assign(key.get_string().data(), key.get_string().size());
+						}
+						claujson::clean(key);
+					}
+				}
+			}
+		}
+
+		// events of tokens [from, to), false if handler returns false or a value is not valid.
+		static bool sax(char* buf, uint64_t buf_len, const _simdjson::internal::dom_parser_implementation* imple,
+			uint64_t from, uint64_t to, const std_vector<SaxLevel>& path, SaxHandler& handler, const std::atomic<bool>& stop) {
+			const uint32_t* idx = imple->structural_indexes.get();
+			const uint64_t n = imple->n_structural_indexes;
+			_Value x; // reused.
+
+			bool ok = handler.begin(path);
+			for (uint64_t i = from; ok && i < to; ++i) {
+				if ((i & 4095) == 0 && stop.load(std::memory_order_relaxed)) {
+					ok = false;
+					break;
+				}
+				switch (buf[idx[i]]) {
+				case ',':
+				case ':':
+					break;
+				case '[':
+					ok = handler.start_array();
+					break;
+				case ']':
+					ok = handler.end_array();
+					break;
+				case '{':
+					ok = handler.start_object();
+					break;
+				case '}':
+					ok = handler.end_object();
+					break;
+				default:
+				{
+					const bool is_key = i + 1 < n && buf[idx[i + 1]] == ':';
+					bool err = false;
+					Convert(x, idx[i], i + 1 < n ? idx[i + 1] : buf_len, is_key, buf, i, err);
+					ok = !err && (is_key ? handler.key(x) : handler.value(x));
+				}
+				break;
+				}
+			}
+			ok = ok && handler.end();
+			claujson::clean(x);
+			return ok;
+		}
+
+	private:
+		//                         
+		 static void _write(StrStream& stream, const _Value& data, std_vector<StructuredPtr>& chk_list, const int depth, const Layout& layout);
+		 static void _write(StrStream& stream, const _Value& data, const int depth, const Layout& layout);
+
+		 static void write_(StrStream& stream, const _Value& global, StructuredPtr temp, const Layout& layout, bool hint);
+
+	public:
+		// test?... just Data has one element 
+		 void write(const std::string& fileName, const _Value& global, const Layout& layout, bool hint = false);
+
+		 void write(std::ostream& stream, const _Value& data, const Layout& layout);
+
+		 bool write(Sink& sink, const _Value& data, const Layout& layout);
+
+		 std::string write_to_str(const _Value& data, const Layout& layout);
+		 std::string write_to_str2(const _Value& data, const Layout& layout);
+
+		 void write_parallel(const std::string& fileName, _Value& j, uint64_t thr_num, const Layout& layout, bool parents);
+		 void write_parallel2(const std::string& fileName, const _Value& j, uint64_t thr_num, const Layout& layout);
+		 bool write_parallel2(Sink& sink, const _Value& j, uint64_t thr_num, const Layout& layout);
+
+		 // array and object spans in the input, and mark them clean.
+		 static void record_spans(_Value& root, const char* buf, const _simdjson::internal::dom_parser_implementation* imple, uint64_t length, SourceSpans& out);
+
+		 bool write_incremental(Sink& sink, const Document& d);
+		 void write_incremental(const std::string& fileName, const Document& d);
+	private:
+		 bool write_chunks(std_vector<StrStream>& stream, const _Value& j, uint64_t thr_num, const Layout& layout);
+
+		 static void _write_incremental(StrStream& stream, const _Value& data, const SourceSpans* spans);
+
+	};
+
+	claujson_inline void _write_string(StrStream& stream, char ch) {
+		switch (ch) {
+		case '\\':
+			stream.add_2("\\\\");
 			break;
 		case '\"':
 			stream.add_2("\\\"");
@@ -2134,14 +2816,6 @@ namespace claujson {
 		stream.add_char('\"');
 	}
 
-	static    const char* str_open_array[] = { "[", " [ \n",  };
-	static   const  char* str_open_object[] = { "{", " { \n",  };
-	static   const  char* str_close_array[] = { "]", " ] \n", };
-	static   const  char* str_close_object[] = { "}", " } \n", };
-	static   const  char* str_comma[] = { ",", " , " };
-	static   const  char* str_colon[] = { ":", " : " };
-	static   const  char* str_space[] = { "", " " };
-
 	claujson_inline void write_primitive(StrStream& stream, const _Value& x) {
 		if (x.is_str()) {
 
@@ -2164,26 +2838,51 @@ namespace claujson {
 			stream.add_2("null");
 		}
 	}
-	std::string LoadData2::write_to_str(const _Value& global, bool pretty) {
-		StrStream stream;
+
+	// for Layout::compact_scalar_array
+	static bool is_scalar_array(const _Value& x) {
+		const Array* arr = x.as_array();
+		if (!arr || arr->get_data_size() == 0) {
+			return false;
+		}
+		const uint64_t len = arr->get_data_size();
+		for (uint64_t i = 0; i < len; ++i) {
+			if (arr->get_value_list(i).is_structured()) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::string LoadData2::write_to_str(const _Value& global, const Layout& layout) {
+		std::string result;
+		{
+			BufferSink sink(result);
+			write(sink, global, layout);
+		}
+		return result;
+	}
+
+	bool LoadData2::write(Sink& sink, const _Value& global, const Layout& layout) {
+		StrStream stream(&sink);
 
 		if (global.is_structured()) {
 			bool is_arr = global.is_array();
 
 			if (is_arr) {
-				stream.add_2(str_open_array[pretty ? 1 : 0]);
+				stream.add_char('[');
 			}
 			else {
-				stream.add_2(str_open_object[pretty ? 1 : 0]);
+				stream.add_char('{');
 			}
 
-			_write(stream, global, 0, pretty);
+			_write(stream, global, 0, layout);
 
 			if (is_arr) {
-				stream.add_2(str_close_array[pretty ? 1 : 0]);
+				stream.add_char(']');
 			}
 			else {
-				stream.add_2(str_close_object[pretty ? 1 : 0]);
+				stream.add_char('}');
 			}
 
 		}
@@ -2191,12 +2890,13 @@ namespace claujson {
 			auto& x = global;
 			write_primitive(stream, x);
 		}
+		layout.end(stream);
 
-		return std::string(stream.buf(), stream.buf_size());
+		return stream.end();
 	}
 
-		//                           
-	void LoadData2::_write(StrStream& stream, const _Value& data, std_vector<StructuredPtr>& chk_list, const int depth, bool pretty) {
+	// writes elements of data(at depth), `[`, `{`, `]`, `}` of data are written by caller.
+	void LoadData2::_write(StrStream& stream, const _Value& data, std_vector<StructuredPtr>& chk_list, const int depth, const Layout& layout) {
 		StructuredPtr ut;
 
 		if (data.is_structured()) {
@@ -2206,51 +2906,62 @@ namespace claujson {
 			return;
 		}
 
+		// not closed here, rest is in next part.
+		const bool open_end = std::find(chk_list.begin(), chk_list.end(), ut) != chk_list.end();
+
 		if (ut && ut.is_object()) {
 			uint64_t len = ut.get_data_size();
 			for (uint64_t i = 0; i < len; ++i) {
 				if (ut.get_value_list(i).is_structured()) {
+					auto y = (StructuredPtr(ut.get_value_list(i)));
+
+					if (y.is_virtual() == false) { // virtual -> continued from prev part.
+						if (i > 0) {
+							stream.add_char(',');
+						}
+						layout.newline(stream, depth + 1);
+					}
+
 					auto& x = ut.get_key_list(i);
 
 					if (x.is_str()) {
 
 						write_string(stream, StringView(x.str_val().data(), x.str_val().size()));
 
-						{
-							stream.add_2(str_colon[pretty ? 1 : 0]);
-						}
+						layout.colon(stream);
 					}
 					else {
 						//log << warn  << "Error : no key\n";
 					}
 
-					auto y = (StructuredPtr(ut.get_value_list(i)));
-
 					if (y.is_object() && y.is_virtual() == false) {
-						stream.add_2(str_open_object[pretty ? 1 : 0]); // "{";
+						stream.add_char('{');
 					}
 					else if (y.is_array() && y.is_virtual() == false) {
-						stream.add_2(str_open_array[pretty ? 1 : 0]); // "[";
+						stream.add_char('[');
 					}
 
-					_write(stream, ut.get_value_list(i), chk_list, depth + 1, pretty);
+					_write(stream, ut.get_value_list(i), chk_list, depth + 1, layout);
 
 					if (y.is_object() && std::find(chk_list.begin(), chk_list.end(), y) == chk_list.end()) {
-						stream.add_2(str_close_object[pretty ? 1 : 0]); // "}";
+						stream.add_char('}');
 					}
 					else if (y.is_array() && std::find(chk_list.begin(), chk_list.end(), y) == chk_list.end()) {
-						stream.add_2(str_close_array[pretty ? 1 : 0]); // "]";
+						stream.add_char(']');
 					}
 				}
 				else {
+					if (i > 0) {
+						stream.add_char(',');
+					}
+					layout.newline(stream, depth + 1);
+
 					auto& x = ut.get_key_list(i);
 
 					if (x.is_str()) {
 						write_string(stream, StringView(x.str_val().data(), x.str_val().size()));
 
-						{
-							stream.add_2(str_colon[pretty ? 1 : 0]); // " : ";
-						}
+						layout.colon(stream);
 					}
 
 					{
@@ -2259,49 +2970,72 @@ namespace claujson {
 						write_primitive(stream, x);
 					}
 				}
+			}
 
-				if (i < ut.get_data_size() - 1) {
-					stream.add_2(str_comma[pretty ? 1 : 0]); // ",";
-				}
+			if (!open_end && (len > 0 || ut.is_virtual())) {
+				layout.newline(stream, depth);
 			}
 		}
 		else if (ut && ut.is_array()) {
 			uint64_t len = ut.get_data_size();
+
+			if (layout.compact_scalar_array && !open_end && !ut.is_virtual() && is_scalar_array(data)) {
+				for (uint64_t i = 0; i < len; ++i) {
+					if (i > 0) {
+						layout.compact_comma(stream);
+					}
+					write_primitive(stream, ut.get_value_list(i));
+				}
+				return;
+			}
+
 			for (uint64_t i = 0; i < len; ++i) {
 				if (ut.get_value_list(i).is_structured()) {
 
 					auto y = (StructuredPtr(ut.get_value_list(i)));
 
+					if (y.is_virtual() == false) {
+						if (i > 0) {
+							stream.add_char(',');
+						}
+						layout.newline(stream, depth + 1);
+					}
+
 					if (y.is_object() && y.is_virtual() == false) {
-						stream.add_2(str_open_object[pretty ? 1 : 0]); // "{";
+						stream.add_char('{');
 					}
 					else if (y.is_array() && y.is_virtual() == false) {
-						stream.add_2(str_open_array[pretty ? 1 : 0]); // "[";
+						stream.add_char('[');
 					}
 
-					_write(stream, ut.get_value_list(i), chk_list, depth + 1, pretty);
+					_write(stream, ut.get_value_list(i), chk_list, depth + 1, layout);
 
 					y = ((StructuredPtr)(ut.get_value_list(i)));
 
 
 					if (y.is_object() && std::find(chk_list.begin(), chk_list.end(), y) == chk_list.end()) {
-						stream.add_2(str_close_object[pretty ? 1 : 0]); // "}";
+						stream.add_char('}');
 					}
 					else if (y.is_array() && std::find(chk_list.begin(), chk_list.end(), y) == chk_list.end()) {
-						stream.add_2(str_close_array[pretty ? 1 : 0]); // "]";
+						stream.add_char(']');
 					}
 
 				}
 				else {
+					if (i > 0) {
+						stream.add_char(',');
+					}
+					layout.newline(stream, depth + 1);
+
 					auto& x = ut.get_value_list(i);
 
 
 					write_primitive(stream, x);
 				}
+			}
 
-				if (i < ut.get_data_size() - 1) {
-					stream.add_2(str_comma[pretty ? 1 : 0]); // ",";
-				}
+			if (!open_end && (len > 0 || ut.is_virtual())) {
+				layout.newline(stream, depth);
 			}
 		}
 		else if (data) { // valid
@@ -2311,7 +3045,8 @@ namespace claujson {
 		}
 	}
 
-	void LoadData2::_write(StrStream& stream, const _Value& data, const int depth, bool pretty) {
+	// writes elements of data(at depth), `[`, `{`, `]`, `}` of data are written by caller.
+	void LoadData2::_write(StrStream& stream, const _Value& data, const int depth, const Layout& layout) {
 		StructuredPtr ut;
 
 		if (data.is_structured()) {
@@ -2324,20 +3059,18 @@ namespace claujson {
 		if (ut && ut.is_object()) {
 			uint64_t len = ut.get_data_size();
 			for (uint64_t i = 0; i < len; ++i) {
+				if (i > 0) {
+					stream.add_char(',');
+				}
+				layout.newline(stream, depth + 1);
+
 				if (ut.get_value_list(i).is_structured()) {
 					auto& x = ut.get_key_list(i);
 
 					if (x.is_str()) {
-
-
-						uint64_t len = x.str_val().size();
-
 						write_string(stream, StringView(x.str_val().data(), x.str_val().size()));
 
-
-						{
-							stream.add_2(str_colon[pretty ? 1 : 0]); // " : ";
-						}
+						layout.colon(stream);
 					}
 					else {
 						//log << warn  << "Error : no key\n"; // chk...
@@ -2346,36 +3079,28 @@ namespace claujson {
 					auto y = (StructuredPtr(ut.get_value_list(i)));
 
 					if (y.is_object() && y.is_virtual() == false) {
-						stream.add_2(str_open_object[pretty ? 1 : 0]);
+						stream.add_char('{');
 					}
 					else if (y.is_array() && y.is_virtual() == false) {
-						stream.add_2(str_open_array[pretty ? 1 : 0]);
+						stream.add_char('[');
 					}
 
-					_write(stream, ut.get_value_list(i), depth + 1, pretty);
+					_write(stream, ut.get_value_list(i), depth + 1, layout);
 
 					if (y.is_object()) {
-						stream.add_2(str_close_object[pretty ? 1 : 0]);
+						stream.add_char('}');
 					}
 					else if (y.is_array()) {
-						stream.add_2(str_close_array[pretty ? 1 : 0]);
+						stream.add_char(']');
 					}
 				}
 				else {
 					auto& x = ut.get_key_list(i);
 
 					if (x.is_str()) {
-				
-
-						uint64_t len = x.str_val().size();
 						write_string(stream, StringView(x.str_val().data(), x.str_val().size()));
 
-
-
-
-						{
-							stream.add_2(str_colon[pretty ? 1 : 0]);
-						}
+						layout.colon(stream);
 					}
 
 					{
@@ -2384,36 +3109,49 @@ namespace claujson {
 						write_primitive(stream, x);
 					}
 				}
+			}
 
-				if (i < ut.get_data_size() - 1) {
-					stream.add_2(str_comma[pretty ? 1 : 0]);
-				}
+			if (len > 0) {
+				layout.newline(stream, depth);
 			}
 		}
 		else if (ut && ut.is_array()) {
 			uint64_t len = ut.get_data_size();
+
+			if (layout.compact_scalar_array && is_scalar_array(data)) {
+				for (uint64_t i = 0; i < len; ++i) {
+					if (i > 0) {
+						layout.compact_comma(stream);
+					}
+					write_primitive(stream, ut.get_value_list(i));
+				}
+				return;
+			}
+
 			for (uint64_t i = 0; i < len; ++i) {
+				if (i > 0) {
+					stream.add_char(',');
+				}
+				layout.newline(stream, depth + 1);
+
 				if (ut.get_value_list(i).is_structured()) {
 
 					auto y = (StructuredPtr(ut.get_value_list(i)));
 
 					if (y.is_object() && y.is_virtual() == false) {
-						stream.add_2(str_open_object[pretty ? 1 : 0]);
+						stream.add_char('{');
 					}
 					else if (y.is_array() && y.is_virtual() == false) {
-						stream.add_2(str_open_array[pretty ? 1 : 0]);
+						stream.add_char('[');
 					}
 
-					_write(stream, ut.get_value_list(i), depth + 1, pretty);
-
-					y = StructuredPtr(ut.get_value_list(i));
-
+					_write(stream, ut.get_value_list(i), depth + 1, layout);
 
 					if (y.is_object()) {
-						stream.add_2(str_close_object[pretty ? 1 : 0]);
+						stream.add_char('}');
 					}
 					else if (y.is_array()) {
-						stream.add_2(str_close_array[pretty ? 1 : 0]);
+						stream.add_char(']');
 					}
 
 				}
@@ -2422,10 +3160,10 @@ namespace claujson {
 
 					write_primitive(stream, x);
 				}
+			}
 
-				if (i < ut.get_data_size() - 1) {
-					stream.add_2(str_comma[pretty? 1 : 0]);
-				}
+			if (len > 0) {
+				layout.newline(stream, depth);
 			}
 		}
 		else if (data) { // valid
@@ -2436,40 +3174,41 @@ namespace claujson {
 	}
 
 	// todo... just Data has one element 
-	void LoadData2::write(const std::string& fileName, const _Value& global, bool pretty, bool hint) {
+	void LoadData2::write(const std::string& fileName, const _Value& global, const Layout& layout, bool hint) {
 		StrStream stream;
 
 		if (global.is_structured()) {
 			if (hint) {
-				stream.add_2(str_comma[pretty ? 1 : 0]);
+				stream.add_char(',');
 			}
 			bool is_arr = global.is_array();
 
 			if (is_arr) {
-				stream.add_2(str_open_array[pretty ? 1 : 0]);
+				stream.add_char('[');
 			}
 			else {
-				stream.add_2(str_open_object[pretty ? 1 : 0]);
+				stream.add_char('{');
 			}
 
-			_write(stream, global, 1, pretty);
+			_write(stream, global, 0, layout);
 
 			if (is_arr) {
-				stream.add_2(str_close_array[pretty ? 1 : 0]);
+				stream.add_char(']');
 			}
 			else {
-				stream.add_2(str_close_object[pretty ? 1 : 0]);
+				stream.add_char('}');
 			}
 
 		}
 		else {
 			if (hint) {
-				stream.add_2(str_comma[pretty ? 1 : 0]);
+				stream.add_char(',');
 			}
 			auto& x = global;
 
 			write_primitive(stream, x);
 		}
+		layout.end(stream);
 
 		std::ofstream outFile;
 		outFile.open(fileName, std::ios::binary); // binary!
@@ -2479,13 +3218,13 @@ namespace claujson {
 		}
 	}
 
-	void LoadData2::write(std::ostream& stream, const _Value& data, bool pretty) {
+	void LoadData2::write(std::ostream& stream, const _Value& data, const Layout& layout) {
 		StrStream str_stream;
-		_write(str_stream, data, 0, pretty);
+		_write(str_stream, data, 0, layout);
 		stream << StringView(str_stream.buf(), str_stream.buf_size());
 	}
 
-	void LoadData2::write_(StrStream& stream, const _Value& global, StructuredPtr temp, bool pretty, bool hint) {
+	void LoadData2::write_(StrStream& stream, const _Value& global, StructuredPtr temp, const Layout& layout, bool hint) {
 
 		std_vector<StructuredPtr> chk_list; // point for division?, virtual nodes? }}}?
 
@@ -2498,31 +3237,31 @@ namespace claujson {
 
 		if (global.is_structured()) {
 			if (hint) {
-				stream.add_2(str_comma[pretty ? 1 : 0]); // stream << ",";
+				stream.add_char(','); // stream << ",";
 			}
 
 			StructuredPtr j = global;
 
 
 			if (j.is_array() && j.is_virtual() == false) {
-				stream.add_2(str_open_array[pretty ? 1 : 0]);
+				stream.add_char('[');
 			}
 			else if (j.is_object() && j.is_virtual() == false) {
-				stream.add_2(str_open_object[pretty ? 1 : 0]);
+				stream.add_char('{');
 			}
 
-			_write(stream, global, chk_list, 1, pretty);
+			_write(stream, global, chk_list, 0, layout);
 
 			if (j.is_array() && std::find(chk_list.begin(), chk_list.end(), j) == chk_list.end()) {
-				stream.add_2(str_close_array[pretty ? 1 : 0]);
+				stream.add_char(']');
 			}
 			else if (j.is_object() && std::find(chk_list.begin(), chk_list.end(), j) == chk_list.end()) {
-				stream.add_2(str_close_object[pretty ? 1 : 0]);
+				stream.add_char('}');
 			}
 		}
 		else {
 			if (hint) {
-				stream.add_2(str_comma[pretty ? 1 : 0]);
+				stream.add_char(',');
 			}
 
 			auto& x = global;
@@ -2532,23 +3271,30 @@ namespace claujson {
 	}
 
 
-	void LoadData2::write_parallel(const std::string& fileName, _Value& j, uint64_t thr_num, bool pretty) {
+	void LoadData2::write_parallel(const std::string& fileName, _Value& j, uint64_t thr_num, const Layout& layout, bool parents) {
 
 		if (!j.is_structured()) {
-			write(fileName, j, pretty, false);
+			write(fileName, j, layout, false);
 			return;
 		}
 
-		if (thr_num <= 0) {
-			thr_num = std::max((int)std::thread::hardware_concurrency() - 2, 1);
+		if (!parents) { // Divide needs get_parent().
+			write_parallel2(fileName, j, thr_num, layout);
+			return;
+		}
 
+		// size of j, for thr_num and for the split.
+		uint64_t len = 0;
+		if (thr_num != 1) {
+			len = j.is_array() ? Size(j.as_array()) : Size(j.as_object());
 		}
+
 		if (thr_num <= 0) {
-			thr_num = 1;
+			thr_num = cost_model().write_threads(len, pool->size());
 		}
 
 		if (thr_num == 1) {
-			write(fileName, j, pretty, false);
+			write(fileName, j, layout, false);
 			return;
 		}
 
@@ -2567,7 +3313,6 @@ namespace claujson {
 		std_vector<claujson::StrStream> stream(thr_num);
 
 		//std_vector<std::thread> thr(thr_num);
-		std_vector<std::future<void>> thr_result(thr_num);
 
 		//temp = Divide2(thr_num, j, result, hint);
 		
@@ -2579,17 +3324,6 @@ namespace claujson {
 					break;
 				}
 
-				auto a = std::chrono::steady_clock::now();
-				uint64_t len = 0;
-				if (j.is_array()) {
-					len = Size(j.as_array());
-				}
-				else if (j.is_object()) {
-					len = Size(j.as_object());
-				}
-				auto b = std::chrono::steady_clock::now();
-				auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
-				log << info << "size is " << dur.count() << "ms\n";
 				if (len / n == 0) {
 					quit = true;
 					break;
@@ -2606,15 +3340,15 @@ namespace claujson {
 
 				std_vector<claujson::StructuredPtr> pos(n);
 
-				a = std::chrono::steady_clock::now();
+				auto a = std::chrono::steady_clock::now();
 				{
 					uint64_t idx = 0;
 					auto offset2 = offset;
 
 					Find2(j, n - 1, idx, false, len, offset, offset2, pos, hint);
 				}
-				b = std::chrono::steady_clock::now();
-				dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
+				auto b = std::chrono::steady_clock::now();
+				auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
 				log << info << "Find2 is " << dur.count() << "ms\n";
 
 				for (uint64_t i = 0; i < n - 1; ++i) {
@@ -2627,85 +3361,62 @@ namespace claujson {
 					break;
 				}
 
-				{
-					uint64_t i = 0;
-					for (; i < n - 1; ++i) {
+				// Divide needs get_parent(), only ways from split points to j are checked. (no walk of the tree)
+				for (uint64_t i = 0; i < n - 1 && parents; ++i) {
+					StructuredPtr x = pos[i];
+					while (x && !(x == StructuredPtr(j))) {
+						x = x.get_parent();
+					}
+					parents = (bool)x;
+				}
 
-						if (i > 0 && temp_parent[i - 1] == nullptr) {
-
-							for (uint64_t j = 0; j < i; ++j) {
-								thr_result[j].get();
-							}
-
-							for (uint64_t j = 0; j < i; ++j) {
-								int op = 0;
-
-								Merge2(temp_parent[j], result[j], &temp_parent[j + 1], op);
-
-							}
-
-							for (uint64_t j = 0; j < result.size(); ++j) {
-								if (result[i]) {
-									result[i].Delete();
-								}
-							}
-							quit = true;
-							break;
-						}
-
-						Divide(pos[i], result[i]);
-
-						temp_parent[i] = pos[i].get_parent();
-
-						// chk....-2024.04.21 with json explorer?
-						if (pos[i] == j) {
-							temp_parent[i] = nullptr;
-						}
-
-						if (i == 0) {
-							thr_result[0] = pool->enqueue(write_, std::ref(stream[0]), std::cref(j), temp_parent[0], pretty, (false));
-						}
-						else {
-							thr_result[i] = pool->enqueue(write_, std::ref(stream[i]), std::cref(result[i - 1].get_value_list(0)), temp_parent[i], pretty, (hint[i - 1]));
-						}
-					}
+				if (!parents) {
+					break;
+				}
 
-					if (quit) {
+				// divide all parts first, then they are written at once.
+				uint64_t i = 0;
+				for (; i < n - 1; ++i) {
+					if (i > 0 && temp_parent[i - 1] == nullptr) {
 						break;
 					}
 
-					if (i > 0 && temp_parent[i - 1] == nullptr) {
-						for (uint64_t j = 0; j < i; ++j) {
-							for (uint64_t j = 0; j < i; ++j) {
-								thr_result[j].get();
-							}
+					Divide(pos[i], result[i]);
 
-							int op = 0;
+					temp_parent[i] = pos[i].get_parent();
 
-							Merge2(temp_parent[j], result[j], &temp_parent[j + 1], op);
+					// chk....-2024.04.21 with json explorer?
+					if (pos[i] == j) {
+						temp_parent[i] = nullptr;
+					}
+				}
 
+				if (i > 0 && temp_parent[i - 1] == nullptr) { // merge back, then write with one thread.
+					for (uint64_t k = 0; k < i; ++k) {
+						int op = 0;
 
-						}
+						Merge2(temp_parent[k], result[k], &temp_parent[k + 1], op);
+					}
 
-						for (uint64_t j = 0; j < result.size(); ++j) {
-							if (result[i]) {
-								result[i].Delete();
-							}
+					for (uint64_t k = 0; k < i; ++k) {
+						if (result[k]) {
+							result[k].Delete();
 						}
-
-						quit = true;
-						break;
 					}
 
-					thr_result[i] = pool->enqueue(write_, std::ref(stream[i]), 
-						std::cref(result[i - 1].get_value_list(0)), temp_parent[i], pretty, (hint[i - 1]));
+					quit = true;
+					break;
 				}
 
 				break;
 			}
 		}
+		if (!parents) { // ParseOption::keep_parent = false
+			write_parallel2(fileName, j, thr_num, layout);
+			return;
+		}
 		if (quit) {
-			write(fileName, j, pretty, false);
+			write(fileName, j, layout, false);
 			return;
 		}
 
@@ -2714,7 +3425,7 @@ namespace claujson {
 
 		log << info << "divide... " << dur.count() << "ms\n";
 		//if (temp.size() == 1 && temp[0] == nullptr) {
-		//	write(fileName, j, pretty, false);
+		//	write(fileName, j, layout, false);
 		//	return;
 		//}
 		//auto& temp  = result;
@@ -2724,15 +3435,16 @@ namespace claujson {
 
 		a = std::chrono::steady_clock::now();
 
-		//	thr_result[0] = pool->enqueue(write_, std::ref(stream[0]), std::cref(j), temp_parent[0], pretty, (false));
-
-		//	for (uint64_t i = 1; i < thr_num; ++i) {
-		//		thr_result[i] = pool->enqueue(write_, std::ref(stream[i]), std::cref(result[i - 1]->get_value_list(0)), temp_parent[i], pretty, (hint[i - 1]));
-		//	}
-
-		for (uint64_t i = 0; i < thr_num; ++i) {
-			thr_result[i].get();
-		}
+		// fork-join, this thread takes part. (no blocking wait, so it can be called from a task of the pool)
+		pool->parallel_for(0, thr_num, 1, [&](uint64_t i) {
+			if (i == 0) {
+				write_(stream[0], j, temp_parent[0], layout, false);
+			}
+			else {
+				write_(stream[i], result[i - 1].get_value_list(0), temp_parent[i], layout, hint[i - 1]);
+			}
+		});
+		layout.end(stream[thr_num - 1]);
 
 		b = std::chrono::steady_clock::now();
 		dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
@@ -2771,364 +3483,459 @@ namespace claujson {
 		log << info << "write to file " << dur.count() << "ms\n";
 	}
 
-	class JsonView {
+	// chunked traversal for write_parallel2, write_to_str2. (no JsonView array)
+	//   position in document order is a path of child indices from root,
+	//   { } is root`s `[` or `{`, { i0, .., ik } is `ik`-th child of container at { i0, .., ik-1 }.
+	//   ik == size of container -> `]` or `}` of it.
+	class WriteSplitter {
 	public:
-		const _Value* value;
-		int32_t type; // enum? 0 - ARRAY, 1 - OBJECT, 2 - KEY, 3 - VALUE, 4 - END_ARRAY, 5 - END_OBJECT
-	};
-
-	JsonView* _run(JsonView* view_arr, const _Value* x);
+		WriteSplitter(ThreadPool* pool, uint64_t thr_num) : pool(pool), thr_num(thr_num) {
+			//
+		}
+	private:
+		ThreadPool* pool;
+		uint64_t thr_num;
+		// cached subtree sizes, only for containers on the way to the split points.
+		//   sum[i] - offset of i-th child, sum[size] - offset of `]` or `}`. same unit with Size2.
+		std::map<const void*, std_vector<uint64_t>> cache;
 
-	JsonView* run(JsonView* view_arr, const _Value* x) {
-		auto* view_arr2 = _run(view_arr, x);
-		if (view_arr == view_arr2) {
-			return nullptr;
+		static const int max_depth = 4; // of containers with few children.
+	private:
+		static claujson_inline uint64_t size_of(const _Value& x) {
+			return x.is_array() ? x.as_array()->get_data_size() : x.as_object()->get_data_size();
 		}
-		view_arr2->type = -1;
-		return view_arr2;
-	}
-	JsonView* _run(JsonView* view_arr, const _Value* x) {
-		if (x == nullptr) {
-			return view_arr;
+		static claujson_inline const _Value& child_of(const _Value& x, uint64_t i) {
+			return x.is_array() ? x.as_array()->get_value_list(i) : x.as_object()->get_value_list(i);
 		}
-
-		if (x->is_array()) {
-			// ARRAY
-			JsonView* start = view_arr;
-			(*view_arr) = JsonView{ x, 0 };
-			++view_arr;
-			uint64_t sz = x->as_array()->get_data_size();
-			for (uint64_t i = 0; i < sz; ++i) {
-				if (x->as_array()->get_value_list(i).is_structured()) {
-					view_arr = _run(view_arr, &x->as_array()->get_value_list(i));
-				}
-				else {
-					(*view_arr) = JsonView{ &x->as_array()->get_value_list(i), 3 };
-					++view_arr;
-				}
+		static void _weight(const _Value* x, uint64_t* sum, uint64_t start, uint64_t last) {
+			const uint64_t key = x->is_object() ? 1 : 0;
+			for (uint64_t i = start; i < last; ++i) {
+				const _Value& y = child_of(*x, i);
+				sum[i + 1] = key + (y.is_structured() ? LoadData2::Size2(y) : 1);
 			}
-			(*view_arr) = JsonView{ nullptr, 4 };
-			++view_arr;
 		}
-		else if (x->is_object()) {
-			// OBJECT
-			JsonView* start = view_arr;
-			(*view_arr) = JsonView{ x, 1 };
-			++view_arr;
-			uint64_t sz = x->as_object()->get_data_size();
-			for (uint64_t i = 0; i < sz; ++i) {
-				(*view_arr) = JsonView{ &x->as_object()->get_const_key_list(i), 2 };
-				++view_arr;
 
-				if (x->as_object()->get_value_list(i).is_structured()) {
-					view_arr = _run(view_arr, &x->as_object()->get_value_list(i));
-				}
-				else {
-					(*view_arr) = JsonView{ &x->as_object()->get_value_list(i), 3 };
-					++view_arr;
+		const std_vector<uint64_t>& prefix(const _Value& x, int depth) {
+			const void* ptr = x.is_array() ? (const void*)x.as_array() : (const void*)x.as_object();
+			auto iter = cache.find(ptr);
+			if (iter != cache.end()) {
+				return iter->second;
+			}
+
+			const uint64_t len = size_of(x);
+			const uint64_t key = x.is_object() ? 1 : 0;
+			std_vector<uint64_t> sum(len + 1, 0);
+
+			if (len < thr_num * 2 && depth < max_depth) {
+				// few children, maybe big ones - go down, their sums are needed later anyway.
+				for (uint64_t i = 0; i < len; ++i) {
+					const _Value& y = child_of(x, i);
+					if (y.is_structured()) {
+						sum[i + 1] = key + prefix(y, depth + 1).back() + 1;
+					}
+					else {
+						sum[i + 1] = key + 1;
+					}
 				}
 			}
-			(*view_arr) = JsonView{ nullptr, 5 };
-			++view_arr;
-		}
-		else {
-			(*view_arr) = JsonView{ x, 3 };
-			++view_arr;
+			else if (len < thr_num * 2 || !pool) {
+				_weight(&x, sum.data(), 0, len);
+			}
+			else {
+				pool->parallel_for(0, thr_num, 1, [&](uint64_t i) {
+					uint64_t start = len / thr_num * i;
+					uint64_t last = i == thr_num - 1 ? len : len / thr_num * (i + 1);
+					_weight(&x, sum.data(), start, last);
+				});
+			}
+
+			sum[0] = 1; // `[` or `{`
+			for (uint64_t i = 0; i < len; ++i) {
+				sum[i + 1] += sum[i];
+			}
+
+			return cache.insert(std::make_pair(ptr, std::move(sum))).first->second;
 		}
 
-		return view_arr;
-	}
+		// first position at or after `target`.
+		void locate(const _Value& root, uint64_t target, std_vector<uint64_t>& path) {
+			const _Value* x = &root;
+			uint64_t off = target;
+			int depth = 0;
 
-	void print(JsonView* json_view, JsonView* end, claujson::StrStream& strStream) {
-		
-		while (json_view->type != -1) {
-			if (json_view == end) {
-				return;
-			}
+			path.clear();
 
-			switch (json_view->type) {
-			case 0: // ARRAY
-				strStream.add_char('[');
-				//strStream.add_char(' ');
-				break;
-			case 1: // OBJECT
-				strStream.add_char('{');
-				//strStream.add_char(' ');
-				break;
-			case 2: // KEY
-				write_primitive(strStream, *json_view->value); //strStream.add_1(json_view->value->get_string().data(), json_view->value->get_string().size());
-				//strStream.add_char(' '); 
-				strStream.add_char(':');
-				//strStream.add_char(' '); 
-				break;
-			case 3: // VALUE
-				write_primitive(strStream, *json_view->value);
+			while (true) {
+				const auto& sum = prefix(*x, depth);
+				const uint64_t len = sum.size() - 1;
+				const uint64_t key = x->is_object() ? 1 : 0;
 
-				if ((json_view + 1)->type != 4 && (json_view + 1)->type != 5 && (json_view + 1)->type != -1) {
+				uint64_t i = std::upper_bound(sum.begin(), sum.end(), off) - sum.begin() - 1;
 
-					strStream.add_char(',');
-					//strStream.add_char(' ');
-				}
-				break;
-			case 4: // END_ARRAY
-				strStream.add_char(']');
-				//strStream.add_char('\n');
+				path.push_back(i);
 
-				if ((json_view + 1)->type != 4 && (json_view + 1)->type != 5 && (json_view +1)->type != -1) {
+				if (i >= len) { // `]` or `}`
+					return;
+				}
 
-					strStream.add_char(',');
-					//strStream.add_char(' ');
+				const _Value& y = child_of(*x, i);
+				if (!y.is_structured() || off <= sum[i] + key) {
+					return;
 				}
 
-				break;
-			case 5: // END_OBJECT
-				strStream.add_char('}');
-				//strStream.add_char('\n');
+				off -= sum[i] + key;
+				x = &y;
+				++depth;
+			}
+		}
+	public:
+		// same unit with Size2.
+		uint64_t total(const _Value& root) {
+			return prefix(root, 0).back() + 1;
+		}
 
-				if ((json_view + 1)->type != 4 && (json_view + 1)->type != 5 && (json_view + 1)->type != -1) {
+		// into `parts`, pos[0] is empty (start of document), others are in order, no dup.
+		void split(const _Value& root, uint64_t parts, std_vector<std_vector<uint64_t>>& pos) {
+			const uint64_t total = this->total(root);
 
-					strStream.add_char(',');
-					//strStream.add_char(' ');
+			pos.clear();
+			pos.push_back(std_vector<uint64_t>());
+
+			std_vector<uint64_t> path;
+			for (uint64_t i = 1; i < parts; ++i) {
+				uint64_t target = total / parts * i;
+				if (target == 0) {
+					continue;
+				}
+				locate(root, target, path);
+				if (pos.back() != path) {
+					pos.push_back(path);
 				}
-				break;
 			}
-
-			++json_view;
 		}
-	}
 
-	void print_pretty(JsonView* json_view, JsonView* end, claujson::StrStream& strStream) {
+		// writes from position `from` to `to`(exclusive, nullptr -> end of document)
+		static void write_chunk(StrStream& stream, const _Value& root, const std_vector<uint64_t>* from, const std_vector<uint64_t>* to, const Layout& layout) {
+			struct Frame {
+				const _Value* x;
+				uint64_t idx;
+				uint64_t len;
+				bool compact;
+			};
+			std_vector<Frame> _stack;
 
-		while (json_view->type != -1) {
-			if (json_view == end) {
+			if (!root.is_structured()) {
+				write_primitive(stream, root);
 				return;
 			}
 
-			switch (json_view->type) {
-			case 0: // ARRAY
-				strStream.add_char('[');
-				strStream.add_char(' ');
-				break;
-			case 1: // OBJECT
-				strStream.add_char('{');
-				strStream.add_char(' ');
-				break;
-			case 2: // KEY
-				write_primitive(strStream, *json_view->value);
-				strStream.add_char(' '); 
-				strStream.add_char(':');
-				strStream.add_char(' '); 
-				break;
-			case 3: // VALUE
-				write_primitive(strStream, *json_view->value);
-
-				if ((json_view + 1)->type != 4 && (json_view + 1)->type != 5 && (json_view + 1)->type != -1) {
-
-					strStream.add_char(',');
-					strStream.add_char(' ');
+			if (from->empty()) {
+				stream.add_char(root.is_array() ? '[' : '{');
+				_stack.push_back(Frame{ &root, 0, size_of(root), layout.compact_scalar_array && is_scalar_array(root) });
+			}
+			else {
+				const _Value* x = &root;
+				for (uint64_t k = 0; k < from->size(); ++k) {
+					_stack.push_back(Frame{ x, (*from)[k], size_of(*x), layout.compact_scalar_array && is_scalar_array(*x) });
+					if (k + 1 < from->size()) {
+						x = &child_of(*x, (*from)[k]);
+					}
 				}
-				break;
-			case 4: // END_ARRAY
-				strStream.add_char(']');
-				strStream.add_char('\n');
+			}
 
-				if ((json_view + 1)->type != 4 && (json_view + 1)->type != 5 && (json_view + 1)->type != -1) {
+			while (!_stack.empty()) {
+				Frame& top = _stack.back();
 
-					strStream.add_char(',');
-					strStream.add_char(' ');
+				if (to && _stack.size() == to->size() && top.idx == to->back()) {
+					bool same = true;
+					for (uint64_t k = 0; k + 1 < _stack.size(); ++k) {
+						if (_stack[k].idx != (*to)[k]) {
+							same = false;
+							break;
+						}
+					}
+					if (same) {
+						break;
+					}
 				}
 
-				break;
-			case 5: // END_OBJECT
-				strStream.add_char('}');
-				strStream.add_char('\n');
+				if (top.idx < top.len) {
+					if (top.compact) {
+						if (top.idx > 0) {
+							layout.compact_comma(stream);
+						}
+						write_primitive(stream, child_of(*top.x, top.idx));
+						++top.idx;
+						continue;
+					}
 
-				if ((json_view + 1)->type != 4 && (json_view + 1)->type != 5 && (json_view + 1)->type != -1) {
+					if (top.idx > 0) {
+						stream.add_char(',');
+					}
+					layout.newline(stream, _stack.size());
+
+					if (top.x->is_object()) {
+						const _Value& key = top.x->as_object()->get_const_key_list(top.idx);
+						write_string(stream, StringView(key.str_val().data(), key.str_val().size()));
+						layout.colon(stream);
+					}
 
-					strStream.add_char(',');
-					strStream.add_char(' ');
+					const _Value& y = child_of(*top.x, top.idx);
+					if (y.is_array()) {
+						stream.add_char('[');
+						_stack.push_back(Frame{ &y, 0, size_of(y), layout.compact_scalar_array && is_scalar_array(y) }); // top.idx is in progress.
+					}
+					else if (y.is_object()) {
+						stream.add_char('{');
+						_stack.push_back(Frame{ &y, 0, size_of(y), false });
+					}
+					else {
+						write_primitive(stream, y);
+						++top.idx;
+					}
+				}
+				else {
+					if (top.len > 0 && !top.compact) {
+						layout.newline(stream, _stack.size() - 1);
+					}
+					stream.add_char(top.x->is_array() ? ']' : '}');
+					_stack.pop_back();
+					if (!_stack.empty()) {
+						++_stack.back().idx;
+					}
 				}
-				break;
 			}
-
-			++json_view;
 		}
-	}
+	};
 
-	void LoadData2::write_parallel2(const std::string& fileName, const _Value& j, uint64_t thr_num, bool pretty) {
+	// returns false if j is not splitted, (primitive or thr_num == 1)
+	bool LoadData2::write_chunks(std_vector<StrStream>& stream, const _Value& j, uint64_t thr_num, const Layout& layout) {
 		if (!j.is_structured()) {
-			write(fileName, j, pretty, false);
-			return;
-		}
-
-		if (thr_num <= 0) {
-			thr_num = std::max((int)std::thread::hardware_concurrency() - 2, 1);
-
-		}
-		if (thr_num <= 0) {
-			thr_num = 1;
+			return false;
 		}
 
 		if (thr_num == 1) {
-			write(fileName, j, pretty, false);
-			return;
+			return false;
 		}
 
 		auto a = std::chrono::steady_clock::now();
 		auto b = std::chrono::steady_clock::now();
 
-		std_vector<claujson::StrStream> stream(thr_num);
+		std_vector<std_vector<uint64_t>> pos;
+		{
+			WriteSplitter splitter(pool, thr_num > 0 ? thr_num : pool->size());
+			if (thr_num <= 0) {
+				thr_num = cost_model().write_threads(splitter.total(j), pool->size());
+				if (thr_num == 1) {
+					return false;
+				}
+			}
+			splitter.split(j, thr_num, pos);
+		}
+		thr_num = pos.size();
 
-		a = std::chrono::steady_clock::now();
-		uint64_t size = Size2(j);
 		b = std::chrono::steady_clock::now();
 		auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
-		log << info << "Size2 " << size << " " << dur.count() << "\n";
-
-		a = std::chrono::steady_clock::now();
-		JsonView* view_arr = (JsonView*)calloc(size + 1, sizeof(JsonView));
-		JsonView* view_end = run(view_arr, &j);
-		b = std::chrono::steady_clock::now();
-		dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
-		log << info << "run " << dur.count() << "\n";
+		log << info << "split " << thr_num << " " << dur.count() << "ms\n";
 
-		size = view_end - view_arr;
-		log << info << "size... " << size << "\n";
 		a = std::chrono::steady_clock::now();
-		
-		std_vector<uint64_t> start(thr_num + 1);
-		std_vector<uint64_t> last(thr_num);
-		
-		{
-			std::set<uint64_t> _set; // remove dup.
-
-			for (uint64_t i = 1; i < thr_num; ++i) {
-				uint64_t middle = size / thr_num * i;
-				_set.insert(middle);
-			}
-
-			_set.insert(0);
-			
-			start.resize(1 + _set.size());
-			last.resize(_set.size());
 
-			uint64_t count = 0;
-			for (auto x : _set) { // order is important.
-				start[count] = x;
-				++count;
-			}
-			
-			start.back() = size;
+		stream.clear();
+		stream.resize(thr_num);
 
-			for (uint64_t i = 0; i < count; ++i) {
-				last[i] = start[i + 1];
-			}
+		pool->parallel_for(0, thr_num, 1, [&](uint64_t i) {
+			const std_vector<uint64_t>* to = i + 1 < thr_num ? &pos[i + 1] : nullptr;
+			WriteSplitter::write_chunk(stream[i], j, &pos[i], to, layout);
+		});
+		layout.end(stream[thr_num - 1]);
 
-			thr_num = start.size() - 1;
-		}
+		b = std::chrono::steady_clock::now();
+		dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
+		log << info << "print " << dur.count() << "ms\n";
 
-		std_vector<std::future<void>> thr_result(thr_num);
-		if (pretty) {
-			std_vector<std::thread> thread_print(thr_num);
+		return true;
+	}
 
-			for (uint64_t i = 0; i < thread_print.size(); ++i) {  // end[i] ?
-				thr_result[i] = pool->enqueue(print_pretty, view_arr + start[i], view_arr + last[i], std::ref(stream[i]));
-			}
+	void LoadData2::write_parallel2(const std::string& fileName, const _Value& j, uint64_t thr_num, const Layout& layout) {
+		std_vector<claujson::StrStream> stream;
 
-			for (uint64_t i = 0; i < thread_print.size(); ++i) {
-				thr_result[i].get();
-			}
-		}
-		else {
-			std_vector<std::thread> thread_print(thr_num);
-			
-			for (uint64_t i = 0; i < thread_print.size(); ++i) {
-				thr_result[i] = pool->enqueue(print, view_arr + start[i], view_arr + last[i], std::ref(stream[i]));
-			}
-			
-			for (uint64_t i = 0; i < thread_print.size(); ++i) {
-				thr_result[i].get();
-			}
+		if (!write_chunks(stream, j, thr_num, layout)) {
+			write(fileName, j, layout, false);
+			return;
 		}
-		b = std::chrono::steady_clock::now();
-		dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
-		log << info << "print " << dur.count() << "\n";
 
-		a = std::chrono::steady_clock::now();
+		auto a = std::chrono::steady_clock::now();
 		std::ofstream outFile(fileName, std::ios::binary);
 		if (outFile) {
-			for (uint64_t i = 0; i < thr_num; ++i) {
+			for (uint64_t i = 0; i < stream.size(); ++i) {
 				outFile.write(stream[i].buf(), stream[i].buf_size());
 			}
 
 			outFile.close();
 		}
-		b = std::chrono::steady_clock::now();
-		dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
+		auto b = std::chrono::steady_clock::now();
+		auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
 		log << info << "write to file " << dur.count() << "ms\n";
-	
-		free(view_arr);
 	}
 
-	std::string LoadData2::write_to_str2(const _Value& j, bool pretty) {
+	bool LoadData2::write_parallel2(Sink& sink, const _Value& j, uint64_t thr_num, const Layout& layout) {
+		std_vector<claujson::StrStream> stream;
+
+		if (!write_chunks(stream, j, thr_num, layout)) {
+			return write(sink, j, layout);
+		}
+
+		StrStream out(&sink);
+		for (uint64_t i = 0; i < stream.size(); ++i) {
+			out.add_n(stream[i].buf(), stream[i].buf_size());
+		}
+		return out.end();
+	}
+
+	std::string LoadData2::write_to_str2(const _Value& j, const Layout& layout) {
 		if (j.is_primitive()) {
-			return write_to_str(j, pretty);
+			return write_to_str(j, layout);
 		}
 
-		auto a = std::chrono::steady_clock::now();
-		auto b = std::chrono::steady_clock::now();
+		std::string result;
+		{
+			BufferSink sink(result);
+			claujson::StrStream stream(&sink);
+			std_vector<uint64_t> from;
 
-		claujson::StrStream stream;
+			WriteSplitter::write_chunk(stream, j, &from, nullptr, layout);
+			layout.end(stream);
+			stream.end();
+		}
+		return result;
+	}
 
-		a = std::chrono::steady_clock::now();
-		uint64_t size = Size2(j);
-		b = std::chrono::steady_clock::now();
-		auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
-		log << info << "Size2 " << dur.count() << "\n";
+	void LoadData2::record_spans(_Value& root, const char* buf, const _simdjson::internal::dom_parser_implementation* imple, uint64_t length, SourceSpans& out) {
+		struct Frame {
+			StructuredPtr x;
+			uint64_t next; // next child to find array or object.
+			uint64_t begin;
+		};
+		std_vector<Frame> _stack;
 
-		a = std::chrono::steady_clock::now();
-		JsonView* view_arr = (JsonView*)calloc(size + 1, sizeof(JsonView));
-		JsonView* view_end = run(view_arr, &j);
-		b = std::chrono::steady_clock::now();
-		dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
-		log << info << "run " << dur.count() << "\n";
+		out.span.clear();
 
-		size = view_end - view_arr;
+		// tree is made in order of tokens.
+		for (uint64_t i = 0; i < length; ++i) {
+			const uint64_t idx = imple->structural_indexes[i];
+			const char ch = buf[idx];
 
-		a = std::chrono::steady_clock::now();
-		if (pretty) {
-			print_pretty(view_arr, view_arr + size, stream);
+			if (ch == '[' || ch == '{') {
+				StructuredPtr x;
+				if (_stack.empty()) {
+					x = StructuredPtr(root);
+				}
+				else {
+					Frame& top = _stack.back();
+					while (!top.x.get_value_list(top.next).is_structured()) {
+						++top.next;
+					}
+					x = StructuredPtr(top.x.get_value_list(top.next));
+					++top.next;
+				}
+				_stack.push_back(Frame{ x, 0, idx });
+			}
+			else if (ch == ']' || ch == '}') {
+				Frame& top = _stack.back();
+				out.span[top.x.arr] = std::make_pair(top.begin, idx + 1);
+				top.x.set_clean();
+				_stack.pop_back();
+			}
 		}
-		else {
-			print(view_arr, view_arr + size, stream);
+	}
+
+	void LoadData2::_write_incremental(StrStream& stream, const _Value& data, const SourceSpans* spans) {
+		if (!data.is_structured()) {
+			write_primitive(stream, data);
+			return;
 		}
-		b = std::chrono::steady_clock::now();
-		dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
-		log << info << "print " << dur.count() << "\n";
 
-		free(view_arr);
+		StructuredPtr ut(data);
 
-		return std::string(stream.buf(), stream.buf_size());
-	}
+		if (spans && ut.is_clean()) {
+			auto iter = spans->span.find(ut.arr);
+			if (iter != spans->span.end()) {
+				stream.add_n(spans->source.data() + iter->second.first, iter->second.second - iter->second.first);
+				return;
+			}
+		}
 
-	bool is_valid2(_simdjson::dom::parser_for_claujson& dom_parser, uint64_t start, uint64_t last,
-		int* _start_state, int* _last_state,
-		Vector<int8_t>* _is_array, Vector<int8_t>* _is_virtual_array,
-		uint64_t* count = nullptr
-		) {
+		stream.add_char(ut.is_array() ? '[' : '{');
 
-		const auto& buf = dom_parser.raw_buf();
+		const uint64_t len = ut.get_data_size();
+		for (uint64_t i = 0; i < len; ++i) {
+			if (i > 0) {
+				stream.add_char(',');
+			}
+			if (ut.is_object()) {
+				const _Value& key = ut.get_key_list(i);
+				write_string(stream, StringView(key.str_val().data(), key.str_val().size()));
+				stream.add_char(':');
+			}
+			_write_incremental(stream, ut.get_value_list(i), spans);
+		}
 
-		auto* simdjson_imple = dom_parser.raw_implementation().get();
-		uint64_t idx = start;
-		uint64_t depth = 0;
+		stream.add_char(ut.is_array() ? ']' : '}');
+	}
 
-		Vector<int8_t> is_array;
-		Vector<int8_t> is_virtual_array;
-		Vector<uint64_t> _stack;
+	bool LoadData2::write_incremental(Sink& sink, const Document& d) {
+		StrStream stream(&sink);
+		_write_incremental(stream, d.Get(), d.source_spans());
+		return stream.end();
+	}
 
-		int state = 0;
-		uint64_t no = start;
+	void LoadData2::write_incremental(const std::string& fileName, const Document& d) {
+		StrStream stream;
+		_write_incremental(stream, d.Get(), d.source_spans());
+
+		std::ofstream outFile;
+		outFile.open(fileName, std::ios::binary);
+		if (outFile) {
+			outFile.write(stream.buf(), stream.buf_size());
+			outFile.close();
+		}
+	}
+
+	// from is_valid2, for Validate.
+	struct PartInfo {
+		Vector<uint64_t> open; // not closed in part, token idx of `[` or `{`
+		Vector<int64_t> virtual_count; // items of virtual arrays and objects, (same order with is_virtual_array)
+		Vector<uint64_t> virtual_close; // token idx of their `]` or `}`
+		int64_t rest_count = 0; // items of container that has the end of part, (not opened in part)
+		uint64_t split = 0; // first `,` with min depth in the first half of part.
+		int64_t split_depth = 0; // from start of part.
+	};
+
+	bool is_valid2(_simdjson::dom::parser_for_claujson& dom_parser, uint64_t start, uint64_t last,
+		int* _start_state, int* _last_state,
+		Vector<int8_t>* _is_array, Vector<int8_t>* _is_virtual_array,
+		uint64_t* count = nullptr, PartInfo* info = nullptr, uint64_t* jump = nullptr
+		) {
+
+		const auto& buf = dom_parser.raw_buf();
+
+		auto* simdjson_imple = dom_parser.raw_implementation().get();
+		uint64_t idx = start;
+		uint64_t depth = 0;
+
+		Vector<int8_t> is_array;
+		Vector<int8_t> is_virtual_array;
+		Vector<uint64_t> _stack;
+
+		int state = 0;
+
+		int64_t base_count = start > 0 ? -1 : 0; // items with no container in this part, first `,` is not item.
+		Vector<int64_t> virtual_count;
+		Vector<uint64_t> virtual_close;
+		int64_t rel = 0; // depth from start, < 0 after virtual array or object.
+		uint64_t split = start;
+		int64_t split_depth = 0;
+		const uint64_t half = start + (last - start) / 2;
 
 		if (start > last) {
 			return false;
@@ -3182,12 +3989,12 @@ namespace claujson {
 
 			switch (value) { // start == 0
 			case '{': { if (buf[simdjson_imple->structural_indexes[idx]] == '}') {
-				++idx; log << warn << ("empty object"); count[no++] = 0;
+				++idx; log << warn << ("empty object"); if (count) { count[idx - 2] = 0; } if (jump) { jump[idx - 2] = idx - 1; }
 				break;
 			} *_start_state = 0;  goto object_begin;
 			}
 			case '[': { if (buf[simdjson_imple->structural_indexes[idx]] == ']') {
-				++idx; log << warn << ("empty array"); count[no++] = 0; 
+				++idx; log << warn << ("empty array"); if (count) { count[idx - 2] = 0; } if (jump) { jump[idx - 2] = idx - 1; } 
 				break;
 			} *_start_state = 4;  goto array_begin;
 			}
@@ -3231,7 +4038,8 @@ namespace claujson {
 	object_begin:
 		//log_start_value("object");
 		depth++;
-		count[no] = 0;
+		++rel;
+		if (count) { count[idx - 1] = 0; }
 		{
 			if (idx > last) {
 				goto document_end;
@@ -3245,7 +4053,7 @@ namespace claujson {
 			is_array.push_back(0);
 		}
 
-		_stack.push_back(no++); 
+		_stack.push_back(idx - 1); 
 		//dom_parser.is_array[depth] = false;
 		is_array[depth - 1] = 0;
 		//SIMDJSON_TRY(visitor.visit_object_start(*this));
@@ -3281,12 +4089,12 @@ namespace claujson {
 			auto value = buf[simdjson_imple->structural_indexes[idx++]];
 			switch (value) {
 			case '{': if (buf[simdjson_imple->structural_indexes[idx]] == '}') {
-				++idx;count[no++] = 0;
+				++idx;if (count) { count[idx - 2] = 0; } if (jump) { jump[idx - 2] = idx - 1; }
 				break;
 			}
 					goto object_begin;
 			case '[': if (buf[simdjson_imple->structural_indexes[idx]] == ']') {
-				++idx;count[no++] = 0; 
+				++idx;if (count) { count[idx - 2] = 0; } if (jump) { jump[idx - 2] = idx - 1; } 
 				break;
 			} 
 					goto array_begin;
@@ -3319,7 +4127,10 @@ namespace claujson {
 
 
 		if (!_stack.empty()) {
-			count[_stack.back()]++;
+			if (count) { count[_stack.back()]++; }
+		}
+		else {
+			++base_count;
 		}
 		//else {
 			//if (virtual_count == 0) {
@@ -3340,6 +4151,9 @@ namespace claujson {
 		switch (buf[simdjson_imple->structural_indexes[idx++]]) {
 		case ',':
 			//SIMDJSON_TRY(visitor.increment_count(*this));
+			if (rel < split_depth && idx - 1 <= half) {
+				split = idx - 1; split_depth = rel;
+			}
 		{
 			auto key = buf[simdjson_imple->structural_indexes[idx++]]; // advance();
 			if (_simdjson_unlikely(key != '"')) {
@@ -3364,11 +4178,16 @@ namespace claujson {
 	scope_end:
 		{
 			state = 3;
+			--rel;
 			if (depth > 0) {
+				if (jump) { jump[_stack.back()] = idx - 1; }
 				depth--; is_array.pop_back(); _stack.pop_back(); // if (_stack.empty()) { virtual_count = 0; }
 			}
 			else {
 				// depth <= 0.. virtual array or virtual object..
+				virtual_count.push_back(base_count);
+				virtual_close.push_back(idx - 1);
+				base_count = 0;
 				switch (buf[simdjson_imple->structural_indexes[idx - 1]]) {
 				case ']': 
 					is_virtual_array.push_back(1); //count[virtual_idx] = virtual_count; virtual_count = 0;
@@ -3406,6 +4225,7 @@ namespace claujson {
 					switch (buf[simdjson_imple->structural_indexes[idx]]) {
 					case ']':
 					case '}':
+						++base_count; // closed one is item of next.
 						++idx;
 						goto scope_end;
 						break;
@@ -3426,7 +4246,7 @@ namespace claujson {
 		//
 	array_begin:
 		
-		count[no] = 0;
+		if (count) { count[idx - 1] = 0; }
 		{
 			if (idx > last) {
 				goto document_end;
@@ -3438,10 +4258,11 @@ namespace claujson {
 		state = 4;
 		//log_start_value("array");
 		depth++;
+		++rel;
 		if (is_array.size() < depth) { is_array.push_back(1); }
 		is_array[depth - 1] = 1;
 
-		_stack.push_back(no++);
+		_stack.push_back(idx - 1);
 
 		//SIMDJSON_TRY(visitor.visit_array_start(*this));
 	//	SIMDJSON_TRY(visitor.increment_count(*this));
@@ -3460,9 +4281,9 @@ namespace claujson {
 		{
 			auto value = buf[simdjson_imple->structural_indexes[idx++]];
 			switch (value) {
-			case '{': if (buf[simdjson_imple->structural_indexes[idx]] == '}') { ++idx; count[no++] = 0; 
+			case '{': if (buf[simdjson_imple->structural_indexes[idx]] == '}') { ++idx; if (count) { count[idx - 2] = 0; } if (jump) { jump[idx - 2] = idx - 1; } 
 				break; } goto object_begin;
-			case '[': if (buf[simdjson_imple->structural_indexes[idx]] == ']') { ++idx; count[no++] = 0;
+			case '[': if (buf[simdjson_imple->structural_indexes[idx]] == ']') { ++idx; if (count) { count[idx - 2] = 0; } if (jump) { jump[idx - 2] = idx - 1; }
 				break; } goto array_begin;
 			case ',': { log << warn << "wrong comma.";
 				//if (err) {
@@ -3490,7 +4311,10 @@ namespace claujson {
 
 	array_continue:
 		if (!_stack.empty()) {
-			count[_stack.back()]++;
+			if (count) { count[_stack.back()]++; }
+		}
+		else {
+			++base_count;
 		}
 		//else {
 			//if (virtual_count == 0) {
@@ -3510,7 +4334,11 @@ namespace claujson {
 
 		state = 6;
 		switch (buf[simdjson_imple->structural_indexes[idx++]]) {
-		case ',': goto array_value;
+		case ',':
+			if (rel < split_depth && idx - 1 <= half) {
+				split = idx - 1; split_depth = rel;
+			}
+			goto array_value;
 		case ']': goto scope_end;
 		case ':': { log << warn << "wrong colon.";
 			//if (err) {
@@ -3546,6 +4374,15 @@ namespace claujson {
 			*_is_virtual_array = std::move(is_virtual_array);
 		}
 
+		if (info) {
+			info->open = std::move(_stack);
+			info->virtual_count = std::move(virtual_count);
+			info->virtual_close = std::move(virtual_close);
+			info->rest_count = base_count;
+			info->split = split;
+			info->split_depth = split_depth;
+		}
+
 		return true;
 	}
 
@@ -4222,22 +5059,264 @@ namespace claujson {
 	}
 
 	[[nodiscard]]
-	std::unique_ptr<ThreadPool> pool_init(int thr_num);
+	std::shared_ptr<ThreadPool> pool_init(int thr_num);
+
+	// split tokens at `,` (near length / thr_num * i) and validate each part with is_valid2.
+	//  then start[i] is moved to the shallowest `,` in the first half of part i, (less virtual arrays and objects in LoadData2::parse)
+	//  start[i] : first token of chunk i, start[part_num] = length.
+	//  count_vec : items of each array and object, index is token idx of `[` or `{`, (exact, for reserve) nullptr -> not counted.
+	//  depth : (optional) nesting depth at start[i].
+	//  jump : (optional) token idx of matching `]` or `}`, index is token idx of `[` or `{`.
+	static std::pair<bool, uint64_t> Validate(ThreadPool* pool, _simdjson::dom::parser_for_claujson& test_,
+		uint64_t length, uint64_t thr_num, std_vector<int64_t>& start, uint64_t* count_vec, std_vector<uint64_t>* depth = nullptr,
+		uint64_t* jump = nullptr)
+	{
+		const auto& buf = test_.raw_buf();
+		auto* simdjson_imple_ = test_.raw_implementation().get();
+
+		std::set<uint64_t> _set;
+
+		for (uint64_t i = 1; i < thr_num; ++i) {
+			uint64_t middle = length / thr_num * i;
+			for (uint64_t j = middle; j < length; ++j) {
+				if (buf[simdjson_imple_->structural_indexes[j]] == ',') {
+					_set.insert(j); break;
+				}
+			}
+		}
+
+		_set.insert(0);
+
+		const uint64_t n = _set.size();
+
+		start.resize(1 + n);
+
+		int count = 0;
+		for (auto x : _set) {
+			start[count] = x;
+			++count;
+		}
+		start[n] = length - 1;
+
+		std_vector<int> start_state(n, -1);
+		std_vector<int> last_state(n, -1);
+		std_vector<Vector<int8_t>> is_array(n), is_virtual_array(n);
+		std_vector<PartInfo> info(n);
+
+		if (n > 1) {
+			std_vector<int> result(n, 0);
+
+			pool->parallel_for(0, n, 1, [&](uint64_t i) {
+				result[i] = is_valid2(test_, start[i], start[i + 1], &start_state[i], &last_state[i],
+					&is_array[i], &is_virtual_array[i], count_vec, &info[i], jump);
+			});
+
+			for (uint64_t i = 0; i < n; ++i) {
+				if (!result[i]) {
+					return { false, -1 };
+				}
+			}
+		}
+		else if (!is_valid2(test_, 0, length - 1, &start_state[0], &last_state[0],
+			&is_array[0], &is_virtual_array[0], count_vec, &info[0], jump)) {
+			return { false, -1 };
+		}
+
+		for (uint64_t i = 0; i + 1 < n; ++i) {
+			if (start_state[i + 1] != last_state[i]) { // need more tests.
+				return { false, -2 };
+			}
+		}
+
+		if (is_virtual_array[0].empty() == false) { // first block has no virtual array or virtual object.!
+			return { false, -3 };
+		}
+
+		std_vector<int64_t> part_depth(n, 0);
+		for (uint64_t i = 1; i < n; ++i) { // before is_array[0] is changed.
+			part_depth[i] = part_depth[i - 1] + is_array[i - 1].size() - is_virtual_array[i - 1].size();
+		}
+
+		// count_vec of containers over parts, open[j] is for is_array[0][j].
+		Vector<uint64_t>& open = info[0].open;
+
+		for (uint64_t i = 1; i < n; ++i) {
+			if (is_array[0].empty()) {
+				return { false, -5 };
+			}
+
+			if (false == is_virtual_array[i].empty()) {
+				// remove? matched is_array(or object) and is_virtual_array(or object)
+				if (is_array[0].size() >= is_virtual_array[i].size()) {
+					for (uint64_t j = 0; j < is_virtual_array[i].size(); ++j) {
+						if (is_array[0].back() != is_virtual_array[i][j]) {
+							return { false, -3 };
+						}
+						is_array[0].pop_back();
+						if (count_vec) {
+							count_vec[open.back()] += info[i].virtual_count[j];
+						}
+						if (jump) {
+							jump[open.back()] = info[i].virtual_close[j];
+						}
+						open.pop_back();
+					}
+				}
+				else {
+					return { false, -3 };
+				}
+			}
+			if (count_vec && !open.empty()) {
+				count_vec[open.back()] += info[i].rest_count;
+			}
+			// added...
+			for (uint64_t x = 0; x < is_array[i].size(); ++x) {
+				is_array[0].push_back(is_array[i][x]);
+				open.push_back(info[i].open[x]);
+			}
+		}
+
+		if (false == is_array[0].empty()) {
+			return { false, -4 };
+		}
+
+		for (uint64_t i = 1; i < n; ++i) {
+			start[i] = info[i].split;
+			part_depth[i] += info[i].split_depth;
+		}
+		start[n] = length;
+
+		if (depth) {
+			depth->resize(n);
+			for (uint64_t i = 0; i < n; ++i) {
+				(*depth)[i] = part_depth[i];
+			}
+		}
+
+		return { true, n };
+	}
+
 
 	parser::parser(int thr_num) {
 		pool = pool_init(thr_num);
 	}
 
-	std::pair<bool, uint64_t> parser::parse(const std::string& fileName, Document& d, uint64_t thr_num)
-	{
-		if (thr_num <= 0) {
-			thr_num = std::max((int)std::thread::hardware_concurrency() - 2, 1);
+	parser::parser(std::shared_ptr<ThreadPool> pool) : pool(pool ? std::move(pool) : default_pool()) {
+		//
+	}
+
+	// only primitives from token `i` to `]`?
+	static bool is_scalar_tokens(const char* buf, const _simdjson::internal::dom_parser_implementation* imple, uint64_t length, uint64_t i) {
+		for (; i < length; ++i) {
+			switch (buf[imple->structural_indexes[i]]) {
+			case ']':
+				return true;
+			case '[':
+			case '{':
+			case '}':
+				return false;
+			default:
+				break;
+			}
 		}
-		if (thr_num <= 0) {
-			thr_num = 1;
+		return false;
+	}
+
+	// write tokens [first, last) of valid json, depth : nesting depth at first token.
+	//  strings and numbers are copied as is. (they are checked by Convert)
+	static bool Reformat(StrStream& stream, char* buf, uint64_t buf_len, const _simdjson::internal::dom_parser_implementation* imple,
+		uint64_t length, uint64_t first, uint64_t last, uint64_t depth, const Layout& layout) {
+		_Value temp;
+		bool err = false;
+		bool compact = false; // in compact array, no array or object in it.
+
+		if (layout.compact_scalar_array && first > 0) {
+			// `first` is `,` in compact array? - only primitives before and after it.
+			uint64_t i = first;
+			while (i > 0) {
+				const char ch = buf[imple->structural_indexes[i - 1]];
+				if (ch == '[' || ch == ']' || ch == '{' || ch == '}') {
+					compact = ch == '[' && is_scalar_tokens(buf, imple, length, first);
+					break;
+				}
+				--i;
+			}
+		}
+
+		for (uint64_t i = first; i < last; ++i) {
+			const uint64_t idx = imple->structural_indexes[i];
+			const char ch = buf[idx];
+
+			switch (ch) {
+			case '{':
+			case '[':
+			{
+				const char close = ch == '{' ? '}' : ']';
+				if (i + 1 < length && buf[imple->structural_indexes[i + 1]] == close) { // empty array or object.
+					stream.add_char(ch).add_char(close);
+					++i;
+					break;
+				}
+				stream.add_char(ch);
+				++depth;
+				if (ch == '[' && layout.compact_scalar_array && is_scalar_tokens(buf, imple, length, i + 1)) {
+					compact = true;
+				}
+				else {
+					layout.newline(stream, depth);
+				}
+			}
+				break;
+			case '}':
+			case ']':
+				--depth;
+				if (compact) {
+					compact = false;
+				}
+				else {
+					layout.newline(stream, depth);
+				}
+				stream.add_char(ch);
+				break;
+			case ',':
+				if (compact) {
+					layout.compact_comma(stream);
+				}
+				else {
+					stream.add_char(',');
+					layout.newline(stream, depth);
+				}
+				break;
+			case ':':
+				layout.colon(stream);
+				break;
+			default:
+			{
+				const uint64_t next_idx = i + 1 < length ? imple->structural_indexes[i + 1] : buf_len;
+
+				Convert(temp, idx, next_idx, false, buf, i, err);
+				if (err) {
+					return false;
+				}
+
+				uint64_t end = next_idx; // remove whitespaces.
+				while (end > idx && (buf[end - 1] == ' ' || buf[end - 1] == '\t' || buf[end - 1] == '\n' || buf[end - 1] == '\r')) {
+					--end;
+				}
+				stream.add_n(buf + idx, end - idx);
+			}
+				break;
+			}
 		}
 
+		return true;
+	}
+
+	std::pair<bool, uint64_t> parser::parse(const std::string& fileName, Document& d, uint64_t thr_num, const ParseOption& option)
+	{
 		claujson::clean(d.Get());
+		d.spans.reset();
+		d.parents = option.keep_parent || option.keep_source; // write_incremental needs mark_dirty to reach ancestors.
 		_Value& ut = d.Get();
 
 		uint64_t length = 0;
@@ -4250,6 +5329,7 @@ namespace claujson {
 			log << info << "simdjson-stage1 start\n";
 			// not static??
 
+			jump.clear();
 			auto x = test_.load(fileName);
 
 			if (x.error() != _simdjson::error_code::SUCCESS) {
@@ -4289,161 +5369,59 @@ namespace claujson {
 				return { false, 0 };
 			}
 
+			if (thr_num <= 0) {
+				thr_num = cost_model().parse_threads(length, buf_len, pool->size());
+			}
+
 			auto b = std::chrono::steady_clock::now();
 			dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
 			log << info << "valid1 " << dur.count() << "ms\n";
 
 			b = std::chrono::steady_clock::now();
 
-				std::set<uint64_t> _set;
-			//if (!is_valid(test, length - 1)) {
-			//	return { false, 0 };
-			//}
-			// find ,
-			{
-
-				auto a = std::chrono::steady_clock::now();
-								
-				//if (use_all_function) 
-				{
-
-				//	std_vector<uint64_t> start(thr_num + 1);
-					std_vector<uint64_t> last(thr_num);
-
-					std_vector<int> start_state(thr_num, -1);
-					std_vector<int> last_state(thr_num, -1);
-
-					for (uint64_t i = 1; i < thr_num; ++i) {
-						uint64_t middle = length / thr_num * i;
-						for (uint64_t i = middle; i < length; ++i) {
-							if (buf[simdjson_imple_->structural_indexes[i]] == ',') {
-								middle = i; _set.insert(i); break;
-							}
-
-							if (i == length - 1) {
-								middle = length;
-							}
-						}
-					}
-
-					_set.insert(0);
-
-					start.resize(1 + _set.size());
-					last.resize(_set.size());
-
-					int count = 0;
-					for (auto x : _set) {
-						start[count] = x;
-						++count;
-					}
-					start[_set.size()] = length - 1;
-
-					for (uint64_t i = 0; i < _set.size(); ++i) {
-						last[i] = start[i + 1];
-					}
-
-					std_vector<Vector<int8_t>> is_array(_set.size()), is_virtual_array(_set.size());
-					std_vector<std::future<bool>> thr_result(_set.size());
-					//int err = 0;
-
-					count_vec = (uint64_t*)malloc(length * sizeof(uint64_t));
-					if (!count_vec) {
-						log << "malloc fail in parse function.";
-						return { false, -55 };
-					}
-
-					if (thr_num > 1) {
-
-						for (uint64_t i = 0; i < _set.size(); ++i) {
-							thr_result[i] = pool->enqueue(is_valid2, std::ref(test_), start[i], last[i], &start_state[i], &last_state[i],
-								&is_array[i], &is_virtual_array[i], count_vec);
-						}
-						std_vector<int> result(_set.size());
-
-						for (uint64_t i = 0; i < _set.size(); ++i) {
-							result[i] = static_cast<int>(thr_result[i].get());
-						}
-
-						for (uint64_t i = 0; i < result.size(); ++i) {
-							if (result[i] == false) {
-								free(count_vec);
-								return { false, -1 };
-							}
-						}
-
-						for (uint64_t i = 0; i < _set.size() - 1; ++i) {
-							if (start_state[i + 1] != last_state[i]) { // need more tests.
-								free(count_vec); return { false, -2 };
-							}
-						}
-
-						if (is_virtual_array[0].empty() == false) { // first block has no virtual array or virtual object.!
-							free(count_vec); return { false, -3 };
-						}
-
-						for (uint64_t i = 1; i < _set.size(); ++i) {
-							if (is_array[0].empty()) {
-								free(count_vec);
-								return { false, -5 };
-							}
-
-							if (false == is_virtual_array[i].empty()) {
-								// remove? matched is_array(or object) and is_virtual_array(or object)
-								if (is_array[0].size() >= is_virtual_array[i].size()) {
-									for (uint64_t j = 0; j < is_virtual_array[i].size(); ++j) {
-										if (is_array[0].back() != is_virtual_array[i][j]) {
-											free(count_vec); return { false, -3 };
-										}
-										is_array[0].pop_back();
-									}
-								}
-								else {
-									free(count_vec); return { false, -3 };
-								}
-							}
-							// added...
-							for (uint64_t x = 0; x < is_array[i].size(); ++x) {
-								is_array[0].push_back(is_array[i][x]);
-							}
-
-							//is_array[0].insert(is_array[0].end(), is_array[i].begin(), is_array[i].end());
-						}
+			count_vec = (uint64_t*)malloc(length * sizeof(uint64_t));
+			if (!count_vec) {
+				log << "malloc fail in parse function.";
+				return { false, -55 };
+			}
 
-						if (false == is_array[0].empty()) {
-							free(count_vec); return { false, -4 };
-						}
-					}
-					else {
-						int start_state = 0;
-						int last_state = 0;
+			if (option.keep_jump) {
+				jump.resize(length);
+			}
 
-						if (!is_valid2(test_, 0, length - 1, &start_state, &last_state,
-							nullptr, nullptr, count_vec)) {
-							free(count_vec);
-							return { false, 0 };
-						}
-					}
+			{
+				auto result = Validate(pool.get(), test_, length, thr_num, start, count_vec, nullptr,
+					jump.empty() ? nullptr : jump.data());
+				if (!result.first) {
+					free(count_vec);
+					jump.clear();
+					return result;
 				}
-
-				dur = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - a);
-				log << info << "test time " << dur.count() << "ms\n";
+				thr_num = result.second;
 			}
+
 			dur = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - b);
-			log << info << dur.count() << "ms\n";
+			log << info << "test time " << dur.count() << "ms\n";
 
 			b = std::chrono::steady_clock::now();
 
-			start[_set.size()] = length;
-			thr_num = _set.size();
-
 			LoadData2 p(pool.get());
 						
-			if (false == p.parse(ut, buf, buf_len, simdjson_imple_, length, start, count_vec, 
-				thr_num)) // 0 : use all thread..
+			if (false == p.parse(ut, buf, buf_len, simdjson_imple_, start, count_vec, 
+				d.parents))
 			{
 				free(count_vec);
+				jump.clear();
 				return { false, 0 };
 			}
+
+			if (option.keep_source) {
+				d.spans.reset(new (std::nothrow) SourceSpans());
+				if (d.spans) {
+					d.spans->source.assign(buf, buf_len);
+					LoadData2::record_spans(ut, buf, simdjson_imple_, length, *d.spans);
+				}
+			}
 			auto c = std::chrono::steady_clock::now();
 			dur = std::chrono::duration_cast<std::chrono::milliseconds>(c - b);
 
@@ -4553,26 +5531,21 @@ namespace claujson {
 	}
 	*/
 	
-	std::pair<bool, uint64_t> parser::parse_str(StringView str, Document& d, uint64_t thr_num)
+	std::pair<bool, uint64_t> parser::parse_str(StringView str, Document& d, uint64_t thr_num, const ParseOption& option)
 	{
 		claujson::clean(d.Get());
+		d.spans.reset();
+		d.parents = option.keep_parent || option.keep_source; // write_incremental needs mark_dirty to reach ancestors.
 		_Value& ut = d.Get();
 
 		log << info << str << "\n";
 
-		if (thr_num <= 0) {
-			thr_num = std::max((int)std::thread::hardware_concurrency() - 2, 1);
-
-		}
-		if (thr_num <= 0) {
-			thr_num = 1;
-		}
-
 		uint64_t length = 0;
 
 		auto _ = std::chrono::steady_clock::now();
 		uint64_t* count_vec = nullptr;
 		{
+			jump.clear();
 			auto x = test_.parse(str.data(), str.length());
 
 			if (x.error() != _simdjson::error_code::SUCCESS) {
@@ -4608,697 +5581,2235 @@ namespace claujson {
 				return { false, 0 };
 			}
 
+			if (thr_num <= 0) {
+				thr_num = cost_model().parse_threads(length, buf_len, pool->size());
+			}
+
 			auto b = std::chrono::steady_clock::now();
 			dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
 
 			log << info << dur.count() << "ms\n";
 			b = std::chrono::steady_clock::now();
 
-			//if (use_all_function)
-			
-			std::set<uint64_t> _set;
-			{
-
-				
-
-				//std_vector<uint64_t> start(thr_num + 1);
-				std_vector<uint64_t> last(thr_num);
-
-				std_vector<int> start_state(thr_num, -1);
-				std_vector<int> last_state(thr_num, -1);
-
-				for (uint64_t i = 1; i < thr_num; ++i) {
-					uint64_t middle = length / thr_num * i;
-					for (uint64_t i = middle; i < length; ++i) {
-						if (buf[simdjson_imple_->structural_indexes[i]] == ',') {
-							middle = i; _set.insert(i); break;
-						}
-
-						if (i == length - 1) {
-							middle = length;
-						}
-					}
-				}
-
-				_set.insert(0);
+			count_vec = (uint64_t*)malloc(length * sizeof(uint64_t));
+			if (!count_vec) {
+				log << "malloc fail in parse_str function.";
+				return { false, -55 };
+			}
 
-				start.resize(1 + _set.size());
-				last.resize(_set.size());
+			if (option.keep_jump) {
+				jump.resize(length);
+			}
 
-				int count = 0;
-				for (auto x : _set) {
-					start[count] = x;
-					++count;
+			{
+				auto result = Validate(pool.get(), test_, length, thr_num, start, count_vec, nullptr,
+					jump.empty() ? nullptr : jump.data());
+				if (!result.first) {
+					free(count_vec);
+					jump.clear();
+					return result;
 				}
-				start[_set.size()] = length - 1;
+				thr_num = result.second;
+			}
 
-				for (uint64_t i = 0; i < _set.size(); ++i) {
-					last[i] = start[i + 1];
-				}
+			dur = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - b);
+			log << info << "test time " << dur.count() << "ms\n";
 
-				std_vector<Vector<int8_t>> is_array(_set.size()), is_virtual_array(_set.size());
-				std_vector<std::future<bool>> thr_result(_set.size());
-				count_vec = (uint64_t*)malloc(length * sizeof(uint64_t));
-				if (!count_vec) {
-					log << "malloc fail in parse_str function.";
-					return { false, -55 };
-				}
-				for (uint64_t i = 0; i < _set.size(); ++i) {
-					thr_result[i] = pool->enqueue(is_valid2, std::ref(test_), start[i], last[i], &start_state[i], &last_state[i],
-						&is_array[i], &is_virtual_array[i], count_vec);
-				}
-				std_vector<int> vec(_set.size());
+			b = std::chrono::steady_clock::now();
 
-				for (uint64_t i = 0; i < _set.size(); ++i) {
-					vec[i] = (int)thr_result[i].get();
-				}
+			LoadData2 p(pool.get());
 
-				bool result = true;
+			if (false == p.parse(ut, buf, buf_len, simdjson_imple_, start, count_vec, 
+				d.parents))
+			{
+				free(count_vec);
+				jump.clear();
+				return { false, 0 };
+			}
 
-				for (uint64_t i = 0; i < vec.size(); ++i) {
-					if (vec[i] == false) {
-						free(count_vec); 
-						return { false, -1 };
-					}
-				}
-
-				for (uint64_t i = 0; i < _set.size() - 1; ++i) {
-					if (start_state[i + 1] != last_state[i]) {
-						free(count_vec); 
-						return { false, -2 };
-					}
+			if (option.keep_source) {
+				d.spans.reset(new (std::nothrow) SourceSpans());
+				if (d.spans) {
+					d.spans->source.assign(buf, buf_len);
+					LoadData2::record_spans(ut, buf, simdjson_imple_, length, *d.spans);
 				}
+			}
+			auto c = std::chrono::steady_clock::now();
+			dur = std::chrono::duration_cast<std::chrono::milliseconds>(c - b);
+			log << info << dur.count() << "ms\n";
+		}
+		auto c = std::chrono::steady_clock::now();
+		auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(c - _);
+		log << info << dur.count() << "ms\n";
 
-				if (is_virtual_array[0].empty() == false) { // first block has no virtual array or virtual object.!
-					free(count_vec); 
-					return { false, -3 };
-				}
+		free(count_vec);
+		return  { true, length };
+	}
 
-				for (uint64_t i = 1; i < _set.size(); ++i) {
-					if (is_array[0].empty()) {
-						free(count_vec);
-						return { false, -5 };
-					}
+	std::pair<bool, uint64_t> parser::parse(const std::string& fileName, Document& d, const Projection& projection, uint64_t thr_num, const ParseOption& option) {
+		if (projection.all()) {
+			return parse(fileName, d, thr_num, option);
+		}
+		claujson::clean(d.Get());
+		d.spans.reset();
 
-					if (false == is_virtual_array[i].empty()) {
-						//  
-						if (is_array[0].size() >= is_virtual_array[i].size()) {
-							for (uint64_t j = 0; j < is_virtual_array[i].size(); ++j) {
-								if (is_array[0].back() != is_virtual_array[i][j]) {
-									free(count_vec);
-									return { false, -3 };
-								}
-								is_array[0].pop_back();
-							}
-						}
-						else {
-							free(count_vec); 
-							return { false, -3 };
-						}
-					}
+		if (!stage1(fileName)) {
+			return { false, 0 };
+		}
+		return _project(d, projection, thr_num, option);
+	}
 
-					for (uint64_t x = 0; x < is_array[i].size(); ++x) {
-						is_array[0].push_back(is_array[i][x]);
-					}
-					
-					//is_array[0].insert(is_array[0].end(), is_array[i].begin(), is_array[i].end());
-				}
+	std::pair<bool, uint64_t> parser::parse_str(StringView str, Document& d, const Projection& projection, uint64_t thr_num, const ParseOption& option) {
+		if (projection.all()) {
+			return parse_str(str, d, thr_num, option);
+		}
+		claujson::clean(d.Get());
+		d.spans.reset();
 
-				if (false == is_array[0].empty()) {
-					free(count_vec); 
-					return { false, -4 };
+		if (!stage1_str(str)) {
+			return { false, 0 };
+		}
+		return _project(d, projection, thr_num, option);
+	}
 
-				}
-			}
-			//else {
-			//	if (!is_valid(test, length)) {
-			//		free(count_vec); return { false, 0 };
-			//	}
-			//}
+	std::pair<bool, uint64_t> parser::_project(Document& d, const Projection& projection, uint64_t thr_num, const ParseOption& option) {
+		const auto& buf = test_.raw_buf();
+		const auto buf_len = test_.raw_len();
+		auto* simdjson_imple_ = test_.raw_implementation().get();
+		const uint64_t length = simdjson_imple_->n_structural_indexes;
 
-			dur = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - b);
-			log << info << dur.count() << "ms\n";
+		if (length == 0) {
+			log << warn << "empty string is not valid json";
+			return { false, 0 };
+		}
 
-			b = std::chrono::steady_clock::now();
+		if (thr_num <= 0) {
+			thr_num = cost_model().parse_threads(length, buf_len, pool->size());
+		}
 
-			start[_set.size()] = length;
-			thr_num = _set.size();
+		auto a = std::chrono::steady_clock::now();
 
-			LoadData2 p(pool.get());
+		uint64_t* count_vec = (uint64_t*)malloc(length * sizeof(uint64_t));
+		if (!count_vec) {
+			log << "malloc fail in parse function.";
+			return { false, -55 };
+		}
 
-			if (false == p.parse(ut, buf, buf_len, simdjson_imple_, length, start, count_vec, 
-				thr_num)) // 0 : use all thread..
-			{
+		jump.resize(length); // always needed, to skip values.
+
+		{
+			std_vector<int64_t> start;
+			auto result = Validate(pool.get(), test_, length, thr_num, start, count_vec, nullptr, jump.data());
+			if (!result.first) {
 				free(count_vec);
-				return { false, 0 };
+				jump.clear();
+				return result;
 			}
-			auto c = std::chrono::steady_clock::now();
-			dur = std::chrono::duration_cast<std::chrono::milliseconds>(c - b);
-			log << info << dur.count() << "ms\n";
 		}
-		auto c = std::chrono::steady_clock::now();
-		auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(c - _);
-		log << info << dur.count() << "ms\n";
+
+		auto b = std::chrono::steady_clock::now();
+		auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
+		log << info << "test time " << dur.count() << "ms\n";
+
+		LoadData2 p(pool.get());
+		d.parents = option.keep_parent;
+		const bool ok = p.project(d.Get(), buf, buf_len, simdjson_imple_, jump.data(), count_vec, projection, option.keep_parent);
 
 		free(count_vec);
-		return  { true, length };
-	}
+		if (!ok || !option.keep_jump) {
+			jump.clear();
+		}
+		if (!ok) {
+			return { false, 0 };
+		}
 
-#if __cpp_lib_char8_t
-	// C++20~
-	std::pair<bool, uint64_t> parser::parse_str(std::u8string_view str, Document& d, uint64_t thr_num) {
-		return parse_str(StringView(reinterpret_cast<const char*>(str.data()), str.size()), d, thr_num);
-	}
-#endif
+		dur = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - b);
+		log << info << "project " << dur.count() << "ms\n";
 
-	writer::writer(int thr_num) {
-		pool = pool_init(thr_num);
+		return { true, length };
 	}
-		
-	std::string writer::write_to_str(const _Value& global, bool pretty) {
-		LoadData2 p(pool.get()); 
-		return p.write_to_str(global, pretty);
+
+	std::pair<bool, uint64_t> parser::parse_array(const std::string& fileName, const std::function<bool(uint64_t, _Value&)>& on_element, uint64_t thr_num, const ParseOption& option) {
+		if (!stage1(fileName)) {
+			return { false, 0 };
+		}
+		return _parse_array(on_element, thr_num, option);
 	}
 
-	std::string writer::write_to_str2(const _Value& global, bool pretty) {
-		LoadData2 p(pool.get());
-		return p.write_to_str2(global, pretty);
+	std::pair<bool, uint64_t> parser::parse_array_str(StringView str, const std::function<bool(uint64_t, _Value&)>& on_element, uint64_t thr_num, const ParseOption& option) {
+		if (!stage1_str(str)) {
+			return { false, 0 };
+		}
+		return _parse_array(on_element, thr_num, option);
 	}
 
-	void writer::write(const std::string& fileName, const _Value& global, bool pretty) {
+	std::pair<bool, uint64_t> parser::_parse_array(const std::function<bool(uint64_t, _Value&)>& on_element, uint64_t thr_num, const ParseOption& option) {
+		const auto& buf = test_.raw_buf();
+		const auto buf_len = test_.raw_len();
+		auto* simdjson_imple_ = test_.raw_implementation().get();
+		const uint64_t length = simdjson_imple_->n_structural_indexes;
+
+		if (length == 0) {
+			log << warn << "empty string is not valid json";
+			return { false, 0 };
+		}
+		if (buf[simdjson_imple_->structural_indexes[0]] != '[') {
+			log << warn << "root is not array";
+			return { false, 0 };
+		}
+
+		if (thr_num <= 0) {
+			thr_num = cost_model().parse_threads(length, buf_len, pool->size());
+		}
+
+		uint64_t* count_vec = (uint64_t*)malloc(length * sizeof(uint64_t));
+		if (!count_vec) {
+			log << "malloc fail in parse function.";
+			return { false, -55 };
+		}
+
+		jump.resize(length); // to find elements.
+
+		{
+			std_vector<int64_t> start;
+			auto result = Validate(pool.get(), test_, length, thr_num, start, count_vec, nullptr, jump.data());
+			if (!result.first) {
+				free(count_vec);
+				jump.clear();
+				return result;
+			}
+		}
+
 		LoadData2 p(pool.get());
-		p.write(fileName, global, pretty, false);
+		uint64_t given = 0;
+		bool ok = false;
+		try {
+			ok = p.stream(buf, buf_len, simdjson_imple_, jump.data(), count_vec, std::max<uint64_t>(thr_num, 1) * 8192,
+				on_element, option.keep_parent, given);
+		}
+		catch (...) { // from on_element.
+			free(count_vec);
+			jump.clear();
+			throw;
+		}
+
+		free(count_vec);
+		if (!ok || !option.keep_jump) {
+			jump.clear();
+		}
+		return { ok, given };
 	}
 
-	void writer::write_parallel(const std::string& fileName, _Value& j, uint64_t thr_num, bool pretty) {
-		LoadData2 p(pool.get()); 
-		p.write_parallel(fileName, j, thr_num, pretty);
+	std::pair<bool, uint64_t> parser::parse_sax(const std::string& fileName, const std::function<std::unique_ptr<SaxHandler>()>& make, std_vector<std::unique_ptr<SaxHandler>>& handlers, uint64_t thr_num) {
+		if (!stage1(fileName)) {
+			return { false, 0 };
+		}
+		return _parse_sax(make, handlers, thr_num);
 	}
-	void writer::write_parallel2(const std::string& fileName, const _Value& j, uint64_t thr_num, bool pretty) {
-		LoadData2 p(pool.get()); 
-		p.write_parallel2(fileName, j, thr_num, pretty);
+
+	std::pair<bool, uint64_t> parser::parse_sax_str(StringView str, const std::function<std::unique_ptr<SaxHandler>()>& make, std_vector<std::unique_ptr<SaxHandler>>& handlers, uint64_t thr_num) {
+		if (!stage1_str(str)) {
+			return { false, 0 };
+		}
+		return _parse_sax(make, handlers, thr_num);
 	}
 
-	static std::string escape_for_json_pointer(std::string str) {
-		// 1. ~ -> ~0
-		// 2. / -> ~1
-		
-		{
-			uint64_t idx = 0;
-			idx = str.find('~');
-			while (idx != std::string::npos) {
-				str = str.replace(str.begin() + idx, str.begin() + idx + 1, "~0");
-				idx = str.find("~", idx + 2);
-			}
+	std::pair<bool, uint64_t> parser::_parse_sax(const std::function<std::unique_ptr<SaxHandler>()>& make, std_vector<std::unique_ptr<SaxHandler>>& handlers, uint64_t thr_num) {
+		const auto& buf = test_.raw_buf();
+		const auto buf_len = test_.raw_len();
+		auto* simdjson_imple_ = test_.raw_implementation().get();
+		const uint64_t length = simdjson_imple_->n_structural_indexes;
+
+		handlers.clear();
+
+		if (length == 0) {
+			log << warn << "empty string is not valid json";
+			return { false, 0 };
+		}
+
+		if (thr_num <= 0) {
+			thr_num = cost_model().parse_threads(length, buf_len, pool->size());
 		}
 
+		std_vector<int64_t> start;
 		{
-			uint64_t idx = 0;
-			idx = str.find('/');
-			while (idx != std::string::npos) {
-				str = str.replace(str.begin() + idx, str.begin() + idx + 1, "~1");
-				idx = str.find('/', idx + 2);
+			if (thr_num > 1) {
+				jump.resize(length); // for paths of chunks.
 			}
-		}
 
-		return str;
-	}
+			auto result = Validate(pool.get(), test_, length, thr_num, start, nullptr, nullptr, jump.empty() ? nullptr : jump.data());
 
-	static _Value _diff(const _Value& x, const _Value& y, std_vector<_Value>& route) {
-		_Value result;
-		{
-			Array* temp = new (std::nothrow) Array;
-			if (temp == nullptr) {
-				return _Value(nullptr, false);
+			if (!result.first) {
+				jump.clear();
+				return result;
 			}
-			result = _Value(temp);
+			thr_num = result.second;
 		}
 
-		Array* j = result.as_array();
+		std_vector<std_vector<SaxLevel>> path(thr_num);
+		if (thr_num > 1) {
+			LoadData2::sax_paths(buf, simdjson_imple_, jump.data(), start, thr_num, path);
+		}
+		jump.clear();
 
-		if (x == y) {
-			return result;
+		for (uint64_t i = 0; i < thr_num; ++i) {
+			handlers.push_back(make());
+			if (!handlers.back()) {
+				return { false, 0 };
+			}
 		}
 
-		static const _Value _op_str = _Value("op"sv);
-		static const _Value _path_str = _Value("path"sv);
-		static const _Value _value_str = _Value("value"sv);
-		static const _Value _key_str = _Value("key"sv);
-		static const _Value _last_key_str = _Value("last_key"sv);
-		static const _Value _last_idx_str = _Value("last_idx"sv);
-		static const _Value _replace_str = _Value("replace"sv);
-		static const _Value _remove_str = _Value("remove"sv);
-		static const _Value _add_str = _Value("add"sv);
-	
+		std::atomic<bool> stop{ false };
+		std_vector<int> result(thr_num, 0);
 
-		if (x.type() != y.type()) {
-			Object* obj = new (std::nothrow) Object();
-			
-			if (obj == nullptr) {
-				clean(result);
-				return _Value(nullptr, false);
+		pool->parallel_for(0, thr_num, 1, [&](uint64_t i) {
+			result[i] = LoadData2::sax(buf, buf_len, simdjson_imple_, start[i], start[i + 1], path[i], *handlers[i], stop);
+			if (!result[i]) {
+				stop = true;
 			}
+		});
 
-			obj->add_element(_op_str.clone(), _replace_str.clone());
-			{
-				Array* temp = new (std::nothrow) Array();
-				if (temp == nullptr) {
-					clean(result);
-					delete obj;
-					return _Value(nullptr, false);
-				}
-				for (uint64_t i = 0; i < route.size(); ++i) {
-					temp->add_element(route[i].clone());
-				}
-				obj->add_element(_path_str.clone(), _Value(temp));
+		for (uint64_t i = 0; i < thr_num; ++i) {
+			if (!result[i]) {
+				return { false, 0 };
 			}
-			
-			obj->add_element(_value_str.clone(), _Value(y.clone()));
-
-			j->add_element(_Value(obj));
-			return result;
 		}
+		return { true, length };
+	}
 
-	
+	std::pair<bool, uint64_t> parser::parse_cursor(const std::string& fileName, uint64_t thr_num) {
+		if (!stage1(fileName)) {
+			return { false, 0 };
+		}
+		return _parse_cursor(thr_num);
+	}
 
-		switch (x.type()) {
-		case _ValueType::ARRAY:
-		case _ValueType::OBJECT:
-		{
-			const _Value& jx = x;
-			const _Value& jy = y;
+	std::pair<bool, uint64_t> parser::parse_cursor_str(StringView str, uint64_t thr_num) {
+		if (!stage1_str(str)) {
+			return { false, 0 };
+		}
+		return _parse_cursor(thr_num);
+	}
 
-			if (jx.is_array()) {
-				uint64_t i = 0;
-				uint64_t sz_x = jx.as_array()->get_data_size();
-				uint64_t sz_y = jy.as_array()->get_data_size();
+	std::pair<bool, uint64_t> parser::_parse_cursor(uint64_t thr_num) {
+		const auto buf_len = test_.raw_len();
+		auto* simdjson_imple_ = test_.raw_implementation().get();
+		const uint64_t length = simdjson_imple_->n_structural_indexes;
 
-				for (; i < sz_x && i < sz_y; ++i) {
-					route.push_back(_Value(i));
+		if (length == 0) {
+			log << warn << "empty string is not valid json";
+			return { false, 0 };
+		}
 
-					_Value inner_diff = _diff(jx.as_array()->get_value_list(i), jy.as_array()->get_value_list(i), route);
+		if (thr_num <= 0) {
+			thr_num = cost_model().parse_threads(length, buf_len, pool->size());
+		}
 
-					route.pop_back();
+		jump.resize(length);
 
-					{
-						Array* w = inner_diff.as_array();
-						uint64_t sz_w = w->get_data_size();
+		std_vector<int64_t> start;
+		auto result = Validate(pool.get(), test_, length, thr_num, start, nullptr, nullptr, jump.data());
 
-						for (uint64_t t = 0; t < sz_w; ++t) {
-							_Value temp = std::move(w->get_value_list(t));
-							if (temp.is_array()) {
-								j->add_element(_Value(temp.as_array()));
-							}
-							else if (temp.is_object()) {
-								j->add_element(_Value(temp.as_object()));
-							}
-						}
+		if (!result.first) {
+			jump.clear();
+			return result;
+		}
+		return { true, length };
+	}
 
-						clean(inner_diff);
-					}
-				}
+	Cursor parser::cursor() {
+		return Cursor(test_.raw_buf(), test_.raw_len(), test_.raw_implementation()->structural_indexes.get(), jump.data(), jump.size());
+	}
 
-				if (i < sz_x) {
-					for (uint64_t _i = sz_x; _i > i; --_i) {
-						Object* obj = new (std::nothrow) Object();
+#if __cpp_lib_char8_t
+	// C++20~
+	std::pair<bool, uint64_t> parser::parse_str(std::u8string_view str, Document& d, uint64_t thr_num, const ParseOption& option) {
+		return parse_str(StringView(reinterpret_cast<const char*>(str.data()), str.size()), d, thr_num, option);
+	}
+#endif
 
-						if (obj == nullptr) {
-							clean(result);
-							return _Value(nullptr, false);
-						}
+	uint64_t parser::token_count() const {
+		return jump.size();
+	}
 
-						obj->add_element(_op_str.clone(), _remove_str.clone());
+	char parser::token(uint64_t i) const {
+		auto& test = const_cast<_simdjson::dom::parser_for_claujson&>(test_); // raw_* are not const.
+		return test.raw_buf()[test.raw_implementation()->structural_indexes[i]];
+	}
 
-						{
-							Array* temp = new (std::nothrow) Array();
-							if (temp == nullptr) {
-								clean(result);
-								delete obj;
-								return _Value(nullptr, false);
-							}
-							for (uint64_t i = 0; i < route.size(); ++i) {
-								temp->add_element(route[i].clone());
-							}
-							obj->add_element(_path_str.clone(), _Value(temp));
-						}
+	uint64_t parser::token_offset(uint64_t i) const {
+		auto& test = const_cast<_simdjson::dom::parser_for_claujson&>(test_);
+		return test.raw_implementation()->structural_indexes[i];
+	}
 
-						//obj->add_element(_path_str.clone(), _Value(route));
+	uint64_t parser::match(uint64_t i) const {
+		return jump[i];
+	}
 
-						obj->add_element(_last_idx_str.clone(), _Value(_i - 1));
+	uint64_t parser::skip(uint64_t i) const {
+		switch (token(i)) {
+		case '[':
+		case '{':
+			return jump[i] + 1;
+		case '"':
+			if (i + 1 < jump.size() && token(i + 1) == ':') { // key
+				return skip(i + 2);
+			}
+			return i + 1;
+		default:
+			return i + 1;
+		}
+	}
+
+	bool parser::stage1(const std::string& fileName) {
+		jump.clear();
+		auto x = test_.load(fileName);
+
+		if (x.error() != _simdjson::error_code::SUCCESS) {
+			log << warn << "stage1 error : ";
+			log << warn << x.error() << "\n";
+
+			return false;
+		}
+		return true;
+	}
+
+	bool parser::stage1_str(StringView str) {
+		jump.clear();
+		auto x = test_.parse(str.data(), str.length());
+
+		if (x.error() != _simdjson::error_code::SUCCESS) {
+			log << warn << "stage1 error : ";
+			log << warn << x.error() << "\n";
+
+			return false;
+		}
+		return true;
+	}
+
+	std::pair<bool, uint64_t> parser::reformat(const std::string& fileName, Sink& sink, uint64_t thr_num, bool pretty) {
+		const PrettyOption option;
+		if (!stage1(fileName)) {
+			return { false, 0 };
+		}
+		return _reformat(sink, thr_num, pretty ? &option : nullptr);
+	}
+
+	std::pair<bool, uint64_t> parser::reformat(const std::string& fileName, Sink& sink, uint64_t thr_num, const PrettyOption& option) {
+		if (!stage1(fileName)) {
+			return { false, 0 };
+		}
+		return _reformat(sink, thr_num, &option);
+	}
+
+	std::pair<bool, uint64_t> parser::reformat_str(StringView str, Sink& sink, uint64_t thr_num, bool pretty) {
+		const PrettyOption option;
+		if (!stage1_str(str)) {
+			return { false, 0 };
+		}
+		return _reformat(sink, thr_num, pretty ? &option : nullptr);
+	}
+
+	std::pair<bool, uint64_t> parser::reformat_str(StringView str, Sink& sink, uint64_t thr_num, const PrettyOption& option) {
+		if (!stage1_str(str)) {
+			return { false, 0 };
+		}
+		return _reformat(sink, thr_num, &option);
+	}
+
+	std::pair<bool, uint64_t> parser::_reformat(Sink& sink, uint64_t thr_num, const PrettyOption* option) {
+		const auto& buf = test_.raw_buf();
+		const auto buf_len = test_.raw_len();
+		auto* simdjson_imple_ = test_.raw_implementation().get();
+		const uint64_t length = simdjson_imple_->n_structural_indexes;
+
+		if (length == 0) {
+			log << warn << "empty string is not valid json";
+			return { false, 0 };
+		}
+
+		if (thr_num <= 0) {
+			thr_num = cost_model().parse_threads(length, buf_len, pool->size());
+		}
+
+		auto a = std::chrono::steady_clock::now();
+
+		std_vector<int64_t> start;
+		std_vector<uint64_t> depth;
+		{
+			auto result = Validate(pool.get(), test_, length, thr_num, start, nullptr, &depth);
+
+			if (!result.first) {
+				return result;
+			}
+			thr_num = result.second;
+		}
+
+		auto b = std::chrono::steady_clock::now();
+		auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(b - a);
+		log << info << "test time " << dur.count() << "ms\n";
+
+		const Layout layout = option ? Layout(*option) : Layout(false);
+		StrStream out(&sink);
+
+		if (thr_num == 1) {
+			if (!Reformat(out, buf, buf_len, simdjson_imple_, length, 0, length, 0, layout)) {
+				out.end();
+				return { false, 0 };
+			}
+		}
+		else {
+			std_vector<StrStream> stream(thr_num);
+			std_vector<int> result(thr_num, 0);
+
+			pool->parallel_for(0, thr_num, 1, [&](uint64_t i) {
+				result[i] = Reformat(stream[i], buf, buf_len, simdjson_imple_, length,
+					start[i], start[i + 1], depth[i], layout);
+			});
+
+			for (uint64_t i = 0; i < thr_num; ++i) {
+				if (!result[i]) {
+					return { false, 0 };
+				}
+			}
+
+			for (uint64_t i = 0; i < thr_num; ++i) {
+				out.add_n(stream[i].buf(), stream[i].buf_size());
+			}
+		}
+		layout.end(out);
+
+		if (!out.end()) {
+			return { false, 0 };
+		}
+
+		dur = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - b);
+		log << info << "reformat " << dur.count() << "ms\n";
+
+		return { true, length };
+	}
+
+	writer::writer(int thr_num) {
+		pool = pool_init(thr_num);
+	}
+
+	writer::writer(std::shared_ptr<ThreadPool> pool) : pool(pool ? std::move(pool) : default_pool()) {
+		//
+	}
+		
+	std::string writer::write_to_str(const _Value& global, bool pretty) {
+		LoadData2 p(pool.get()); 
+		return p.write_to_str(global, Layout(pretty));
+	}
+	std::string writer::write_to_str(const _Value& global, const PrettyOption& option) {
+		LoadData2 p(pool.get());
+		return p.write_to_str(global, Layout(option));
+	}
+
+	std::string writer::write_to_str2(const _Value& global, bool pretty) {
+		LoadData2 p(pool.get());
+		return p.write_to_str2(global, Layout(pretty));
+	}
+
+	void writer::write(const std::string& fileName, const _Value& global, bool pretty) {
+		LoadData2 p(pool.get());
+		p.write(fileName, global, Layout(pretty), false);
+	}
+	void writer::write(const std::string& fileName, const _Value& global, const PrettyOption& option) {
+		LoadData2 p(pool.get());
+		p.write(fileName, global, Layout(option), false);
+	}
+
+	bool writer::write(Sink& sink, const _Value& global, bool pretty) {
+		LoadData2 p(pool.get());
+		return p.write(sink, global, Layout(pretty));
+	}
+	bool writer::write(Sink& sink, const _Value& global, const PrettyOption& option) {
+		LoadData2 p(pool.get());
+		return p.write(sink, global, Layout(option));
+	}
+
+	void writer::write_parallel(const std::string& fileName, _Value& j, uint64_t thr_num, bool pretty) {
+		LoadData2 p(pool.get()); 
+		p.write_parallel(fileName, j, thr_num, Layout(pretty), true);
+	}
+	void writer::write_parallel(const std::string& fileName, _Value& j, uint64_t thr_num, const PrettyOption& option) {
+		LoadData2 p(pool.get());
+		p.write_parallel(fileName, j, thr_num, Layout(option), true);
+	}
+	void writer::write_parallel(const std::string& fileName, Document& d, uint64_t thr_num, bool pretty) {
+		LoadData2 p(pool.get());
+		p.write_parallel(fileName, d.Get(), thr_num, Layout(pretty), d.has_parent());
+	}
+	void writer::write_parallel(const std::string& fileName, Document& d, uint64_t thr_num, const PrettyOption& option) {
+		LoadData2 p(pool.get());
+		p.write_parallel(fileName, d.Get(), thr_num, Layout(option), d.has_parent());
+	}
+	void writer::write_parallel2(const std::string& fileName, const _Value& j, uint64_t thr_num, bool pretty) {
+		LoadData2 p(pool.get()); 
+		p.write_parallel2(fileName, j, thr_num, Layout(pretty));
+	}
+	void writer::write_parallel2(const std::string& fileName, const _Value& j, uint64_t thr_num, const PrettyOption& option) {
+		LoadData2 p(pool.get());
+		p.write_parallel2(fileName, j, thr_num, Layout(option));
+	}
+	bool writer::write_parallel2(Sink& sink, const _Value& j, uint64_t thr_num, bool pretty) {
+		LoadData2 p(pool.get());
+		return p.write_parallel2(sink, j, thr_num, Layout(pretty));
+	}
+	bool writer::write_parallel2(Sink& sink, const _Value& j, uint64_t thr_num, const PrettyOption& option) {
+		LoadData2 p(pool.get());
+		return p.write_parallel2(sink, j, thr_num, Layout(option));
+	}
+
+	bool writer::write_incremental(Sink& sink, const Document& d) {
+		LoadData2 p(pool.get());
+		return p.write_incremental(sink, d);
+	}
+	void writer::write_incremental(const std::string& fileName, const Document& d) {
+		LoadData2 p(pool.get());
+		p.write_incremental(fileName, d);
+	}
+	std::string writer::write_incremental_to_str(const Document& d) {
+		std::string result;
+		{
+			BufferSink sink(result);
+			write_incremental(sink, d);
+		}
+		return result;
+	}
+
+	DocumentHandle::Reader::~Reader() {
+		if (handle) {
+			handle->slots[slot].epoch.store(0, std::memory_order_release);
+		}
+	}
+
+	DocumentHandle::DocumentHandle(Document&& d, std::shared_ptr<ThreadPool> pool, uint64_t max_readers)
+		: current(new Document(std::move(d))), slot_count(max_readers > 0 ? max_readers : 1), slots(new Slot[slot_count]),
+		p(std::move(pool)), worker(&DocumentHandle::work, this) {
+		current.load()->freeze();
+	}
+
+	DocumentHandle::~DocumentHandle() {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			stop = true;
+		}
+		condition.notify_all();
+		worker.join();
+
+		for (auto& x : retired) {
+			delete x.doc;
+		}
+		delete current.load();
+	}
+
+	// pin epoch, then load current. a publish after the pin is seen by reclaim through the slot.
+	DocumentHandle::Reader DocumentHandle::read() const {
+		static thread_local uint64_t hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+		for (uint64_t k = 0; ; ++k) {
+			const uint64_t i = (hint + k) % slot_count;
+			const uint64_t e = epoch.load();
+			uint64_t expected = 0;
+			if (slots[i].epoch.compare_exchange_strong(expected, e)) {
+				hint = i;
+				return Reader(this, i, current.load());
+			}
+			if (k > 0 && k % slot_count == 0) {
+				std::this_thread::yield(); // all slots are used.
+			}
+		}
+	}
+
+	uint64_t DocumentHandle::publish(Document&& d) {
+		Document* next = new Document(std::move(d));
+		next->freeze();
+
+		Document* old = current.exchange(next);
+		const uint64_t e = epoch.fetch_add(1);
+		pending_count.fetch_add(1, std::memory_order_relaxed);
+		const uint64_t version = count.fetch_add(1, std::memory_order_acq_rel) + 1;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			retired.push_back({ old, e });
+		}
+		condition.notify_one();
+		return version;
+	}
+
+	std::future<std::pair<bool, uint64_t>> DocumentHandle::reload(const std::string& fileName, uint64_t thr_num, const ParseOption& option) {
+		auto task = std::make_shared<std::packaged_task<std::pair<bool, uint64_t>()>>([this, fileName, thr_num, option]() {
+			Document d;
+			auto x = p.parse(fileName, d, thr_num, option);
+			if (x.first) {
+				publish(std::move(d));
+			}
+			return x;
+		});
+		auto result = task->get_future();
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobs.push_back([task]() { (*task)(); });
+		}
+		condition.notify_one();
+		return result;
+	}
+
+	std::future<std::pair<bool, uint64_t>> DocumentHandle::reload_str(std::string str, uint64_t thr_num, const ParseOption& option) {
+		auto task = std::make_shared<std::packaged_task<std::pair<bool, uint64_t>()>>([this, str = std::move(str), thr_num, option]() {
+			Document d;
+			auto x = p.parse_str(str, d, thr_num, option);
+			if (x.first) {
+				publish(std::move(d));
+			}
+			return x;
+		});
+		auto result = task->get_future();
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobs.push_back([task]() { (*task)(); });
+		}
+		condition.notify_one();
+		return result;
+	}
+
+	// retired ones are taken before slots are read, so readers of them are seen.
+	bool DocumentHandle::reclaim() {
+		std_vector<Retired> now;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			now.swap(retired);
+		}
+
+		uint64_t min = (uint64_t)-1;
+		for (uint64_t i = 0; i < slot_count; ++i) {
+			const uint64_t e = slots[i].epoch.load();
+			if (e && e < min) {
+				min = e;
+			}
+		}
+
+		std_vector<Document*> dead;
+		uint64_t j = 0;
+		for (uint64_t i = 0; i < now.size(); ++i) {
+			if (now[i].epoch < min) {
+				dead.push_back(now[i].doc);
+			}
+			else {
+				now[j++] = now[i];
+			}
+		}
+		now.resize(j);
+
+		bool done;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			retired.insert(retired.end(), now.begin(), now.end());
+			done = retired.empty();
+		}
+
+		for (auto* x : dead) {
+			delete x;
+		}
+		pending_count.fetch_sub(dead.size(), std::memory_order_release);
+		return done;
+	}
+
+	void DocumentHandle::work() {
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;) {
+			if (!jobs.empty()) {
+				std_vector<std::function<void()>> temp;
+				temp.swap(jobs);
+				lock.unlock();
+				for (auto& f : temp) {
+					f();
+				}
+				lock.lock();
+			}
+			else if (stop) {
+				return;
+			}
+			else if (!retired.empty()) {
+				lock.unlock();
+				const bool done = reclaim();
+				lock.lock();
+				if (!done && jobs.empty() && !stop) {
+					condition.wait_for(lock, std::chrono::milliseconds(1)); // readers are still in.
+				}
+			}
+			else {
+				condition.wait(lock);
+			}
+		}
+	}
+
+	char* FixedBufferSink::next(uint64_t min_size, uint64_t* size) {
+		if (cap - used < min_size) {
+			if (!on_overflow || !on_overflow(buf, used)) {
+				return nullptr;
+			}
+			used = 0;
+			if (cap < min_size) {
+				return nullptr;
+			}
+		}
+		*size = cap - used;
+		return buf + used;
+	}
+
+	bool FixedBufferSink::commit(uint64_t used) {
+		this->used += used;
+		return true;
+	}
+
+	char* BufferSink::next(uint64_t min_size, uint64_t* size) {
+		if (out.size() - used < min_size) {
+			out.resize(std::max<uint64_t>(used + min_size, std::max<uint64_t>(out.size() * 2, 256)));
+		}
+		*size = out.size() - used;
+		return &out[0] + used;
+	}
+
+	bool BufferSink::commit(uint64_t used) {
+		this->used += used;
+		return true;
+	}
+
+	bool BufferSink::flush() {
+		out.resize(used);
+		return true;
+	}
+
+	FdSink::FdSink(int fd, uint64_t buf_size) : fd(fd), buf(new char[std::max<uint64_t>(buf_size, 64)]), cap(std::max<uint64_t>(buf_size, 64)) {
+		//
+	}
+
+	char* FdSink::next(uint64_t min_size, uint64_t* size) {
+		if (cap < min_size) { // whole buffer is given each time.
+			return nullptr;
+		}
+		*size = cap;
+		return buf.get();
+	}
+
+	bool FdSink::commit(uint64_t used) {
+		const char* data = buf.get();
+		while (used > 0) {
+#ifdef _WIN32
+			int n = _write(fd, data, (unsigned int)std::min<uint64_t>(used, 1 << 30));
+#else
+			ssize_t n = ::write(fd, data, used);
+#endif
+			if (n < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return false;
+			}
+			data += n;
+			used -= n;
+		}
+		return true;
+	}
+
+	static std::string escape_for_json_pointer(std::string str) {
+		// 1. ~ -> ~0
+		// 2. / -> ~1
+		
+		{
+			uint64_t idx = 0;
+			idx = str.find('~');
+			while (idx != std::string::npos) {
+				str = str.replace(str.begin() + idx, str.begin() + idx + 1, "~0");
+				idx = str.find("~", idx + 2);
+			}
+		}
+
+		{
+			uint64_t idx = 0;
+			idx = str.find('/');
+			while (idx != std::string::npos) {
+				str = str.replace(str.begin() + idx, str.begin() + idx + 1, "~1");
+				idx = str.find('/', idx + 2);
+			}
+		}
+
+		return str;
+	}
+
+	static _Value _diff(const _Value& x, const _Value& y, std_vector<_Value>& route) {
+		_Value result;
+		{
+			Array* temp = new (std::nothrow) Array;
+			if (temp == nullptr) {
+				return _Value(nullptr, false);
+			}
+			result = _Value(temp);
+		}
+
+		Array* j = result.as_array();
+
+		if (x == y) {
+			return result;
+		}
+
+		static const _Value _op_str = _Value("op"sv);
+		static const _Value _path_str = _Value("path"sv);
+		static const _Value _value_str = _Value("value"sv);
+		static const _Value _key_str = _Value("key"sv);
+		static const _Value _last_key_str = _Value("last_key"sv);
+		static const _Value _last_idx_str = _Value("last_idx"sv);
+		static const _Value _replace_str = _Value("replace"sv);
+		static const _Value _remove_str = _Value("remove"sv);
+		static const _Value _add_str = _Value("add"sv);
+	
+
+		if (x.type() != y.type()) {
+			Object* obj = new (std::nothrow) Object();
+			
+			if (obj == nullptr) {
+				clean(result);
+				return _Value(nullptr, false);
+			}
+
+			obj->add_element(_op_str.clone(), _replace_str.clone());
+			{
+				Array* temp = new (std::nothrow) Array();
+				if (temp == nullptr) {
+					clean(result);
+					delete obj;
+					return _Value(nullptr, false);
+				}
+				for (uint64_t i = 0; i < route.size(); ++i) {
+					temp->add_element(route[i].clone());
+				}
+				obj->add_element(_path_str.clone(), _Value(temp));
+			}
+			
+			obj->add_element(_value_str.clone(), _Value(y.clone()));
+
+			j->add_element(_Value(obj));
+			return result;
+		}
+
+	
+
+		switch (x.type()) {
+		case _ValueType::ARRAY:
+		case _ValueType::OBJECT:
+		{
+			const _Value& jx = x;
+			const _Value& jy = y;
+
+			if (jx.is_array()) {
+				uint64_t i = 0;
+				uint64_t sz_x = jx.as_array()->get_data_size();
+				uint64_t sz_y = jy.as_array()->get_data_size();
+
+				for (; i < sz_x && i < sz_y; ++i) {
+					route.push_back(_Value(i));
+
+					_Value inner_diff = _diff(jx.as_array()->get_value_list(i), jy.as_array()->get_value_list(i), route);
+
+					route.pop_back();
+
+					{
+						Array* w = inner_diff.as_array();
+						uint64_t sz_w = w->get_data_size();
+
+						for (uint64_t t = 0; t < sz_w; ++t) {
+							_Value temp = std::move(w->get_value_list(t));
+							if (temp.is_array()) {
+								j->add_element(_Value(temp.as_array()));
+							}
+							else if (temp.is_object()) {
+								j->add_element(_Value(temp.as_object()));
+							}
+						}
+
+						clean(inner_diff);
+					}
+				}
+
+				if (i < sz_x) {
+					for (uint64_t _i = sz_x; _i > i; --_i) {
+						Object* obj = new (std::nothrow) Object();
+
+						if (obj == nullptr) {
+							clean(result);
+							return _Value(nullptr, false);
+						}
+
+						obj->add_element(_op_str.clone(), _remove_str.clone());
+
+						{
+							Array* temp = new (std::nothrow) Array();
+							if (temp == nullptr) {
+								clean(result);
+								delete obj;
+								return _Value(nullptr, false);
+							}
+							for (uint64_t i = 0; i < route.size(); ++i) {
+								temp->add_element(route[i].clone());
+							}
+							obj->add_element(_path_str.clone(), _Value(temp));
+						}
+
+						//obj->add_element(_path_str.clone(), _Value(route));
+
+						obj->add_element(_last_idx_str.clone(), _Value(_i - 1));
+
+						j->add_element(_Value(obj));
+					}
+				}
+				else {
+					for (; i < sz_y; ++i) {
+						Object* obj = new (std::nothrow) Object();
+
+						if (obj == nullptr) {
+							clean(result);
+							return _Value(nullptr, false);
+						}
+
+						obj->add_element(_op_str.clone(), _add_str.clone());
+
+						{
+							Array* temp = new (std::nothrow) Array();
+							if (temp == nullptr) {
+								clean(result);
+								delete obj;
+								return _Value(nullptr, false);
+							}
+							for (uint64_t i = 0; i < route.size(); ++i) {
+								temp->add_element(route[i].clone());
+							}
+							obj->add_element(_path_str.clone(), _Value(temp));
+						}
+						//obj->add_element(_path_str.clone(), _Value(route));
+
+						obj->add_element(_value_str.clone(), _Value(jy.as_array()->get_value_list(i).clone()));
+
+						j->add_element(_Value(obj));
+					}
+				}
+			}
+			else if (jx.is_object()) {
+				uint64_t sz_x = jx.as_object()->get_data_size();
+				uint64_t sz_y = jy.as_object()->get_data_size();
+
+				for (uint64_t i = sz_x; i > 0; --i) {
+					const _Value& key = jx.as_object()->get_key_list(i - 1);
+					uint64_t idx = jy.as_object()->find(key);
+					if (idx != Object::npos) {
+						route.push_back(key.clone());
+						
+						_Value inner_diff = _diff((jx.as_object()->get_value_list(i - 1)), 
+							jy.as_object()->get_value_list(idx), route);
+
+						route.pop_back();
+
+						{
+							Array* w = inner_diff.as_array();
+							uint64_t sz_w = w->get_data_size();
+
+							for (uint64_t t = 0; t < sz_w; ++t) {
+								_Value temp = std::move(w->get_value_list(t));
+								if (temp.is_array()) {
+									j->add_element(_Value(temp.as_array()));
+								}
+								else if (temp.is_object()) {
+									j->add_element(_Value(temp.as_object()));
+								}
+							}
+
+							clean(inner_diff);
+						}
+					}
+					else {
+						Object* obj = new (std::nothrow) Object();
+
+						if (obj == nullptr) {
+							clean(result);
+							return _Value(nullptr, false);
+						}
+						obj->add_element(_op_str.clone(), _remove_str.clone());
+
+						{
+							Array* temp = new (std::nothrow) Array();
+							if (temp == nullptr) {
+								clean(result);
+								delete obj;
+								return _Value(nullptr, false);
+							}
+							for (uint64_t i = 0; i < route.size(); ++i) {
+								temp->add_element(route[i].clone());
+							}
+							obj->add_element(_path_str.clone(), _Value(temp));
+						}
+						
+						//obj->add_element(_path_str.clone(), _Value(route));
+						
+						obj->add_element(_last_key_str.clone(), key.clone());
+
+						j->add_element(_Value(obj));
+					}
+				}
+
+				for (uint64_t i = 0; i < sz_y; ++i) {
+					const _Value& key = jy.as_object()->get_key_list(i);
+					uint64_t idx = jx.as_object()->find(key);
+					if (idx == Object::npos) {
+						Object* obj = new (std::nothrow) Object();
+
+						if (obj == nullptr) {
+							clean(result);
+							return _Value(nullptr, false);
+						}
+
+						obj->add_element(_op_str.clone(), _add_str.clone());
+
+
+						{
+							Array* temp = new (std::nothrow) Array();
+							if (temp == nullptr) {
+								clean(result);
+								delete obj;
+								return _Value(nullptr, false);
+							}
+							for (uint64_t i = 0; i < route.size(); ++i) {
+								temp->add_element(route[i].clone());
+							}
+							obj->add_element(_path_str.clone(), _Value(temp));
+						}
+						
+						//obj->add_element(_path_str.clone(), _Value(route));
+						
+						obj->add_element(_key_str.clone(), _Value(jy.as_object()->get_key_list(i).clone()));
+						obj->add_element(_value_str.clone(), _Value(jy.as_object()->get_value_list(i).clone()));
+
+						j->add_element(_Value(obj));
+					}
+				}
+			}
+		}
+		break;
+
+		case _ValueType::BOOL:
+		case _ValueType::NULL_:
+		case _ValueType::FLOAT:
+		case _ValueType::INT:
+		case _ValueType::UINT:
+		case _ValueType::STRING:
+		case _ValueType::SHORT_STRING:
+		{
+			Object* obj = new (std::nothrow) Object();
+
+			if (obj == nullptr) {
+				clean(result);
+				return _Value(nullptr, false);
+			}
+
+			obj->add_element(_op_str.clone(), _replace_str.clone());
+
+			{
+				Array* temp = new (std::nothrow) Array();
+				if (temp == nullptr) {
+					clean(result);
+					delete obj;
+					return _Value(nullptr, false);
+				}
+				for (uint64_t i = 0; i < route.size(); ++i) {
+					temp->add_element(route[i].clone());
+				}
+				obj->add_element(_path_str.clone(), _Value(temp));
+			}
+
+			//obj->add_element(_path_str.clone(), _Value(route));
+			
+			obj->add_element(_value_str.clone(), _Value(y.clone()));
+
+			j->add_element(_Value(obj));
+			break;
+		}
+		}
+
+		return result;
+	}
+
+
+	_Value diff(const _Value& x, const _Value& y) {
+		std_vector<_Value> vec;
+		return _diff(x, y, vec);
+	}
+
+	static const _Value _op_str = _Value("op"sv);
+	static const _Value _path_str = _Value("path"sv);
+	static const _Value _value_str = _Value("value"sv);
+	static const _Value _key_str = _Value("key"sv);
+	static const _Value _last_key_str = _Value("last_key"sv);
+	static const _Value _last_idx_str = _Value("last_idx"sv);
+
+	// one operation of diff, false if not valid.
+	static bool patch_one(_Value& result, const Object* obj) {
+		uint64_t op_idx = obj->find(_op_str);
+		uint64_t path_idx = obj->find(_path_str);
+		uint64_t value_idx = obj->find(_value_str);
+		uint64_t key_idx = obj->find(_key_str);
+
+		if (op_idx == Object::npos) {
+			//clean(result);
+			return false;
+		}
+
+		if (path_idx == Object::npos) {
+			//clean(result);
+			return false;
+		}
+
+		if (obj->get_value_list(op_idx).str_val() == "replace"sv) {
+			if (value_idx == Object::npos) {
+				//clean(result);
+				return false;
+			}
+
+			std_vector<_Value> vec;
+			const Array* arr = obj->get_value_list(path_idx).as_array();
+			if (arr == nullptr) {
+				//clean(result);
+				return false;
+			}
+			for (uint64_t i = 0; i < arr->size(); ++i) {
+				vec.push_back(arr->get_value_list(i).clone());
+			}
+			_Value& value = result.json_pointerB(vec);
+
+			value = obj->get_value_list(value_idx).clone(); // clone -> std::move(~~)??
+		}
+		else if (obj->get_value_list(op_idx).str_val() == "remove"sv) {
+			std_vector<_Value> vec;
+			const Array* arr = obj->get_value_list(path_idx).as_array();
+			if (arr == nullptr) {
+				//clean(result);
+				return false;
+			}
+			for (uint64_t i = 0; i < arr->size(); ++i) {
+				vec.push_back(arr->get_value_list(i).clone());
+			}
+			_Value& value = result.json_pointerB(vec);
+			_Value& parent = value;
+
+			// case : result.json_pointer returns root?
+			if (!parent) {
+				if (result.is_structured()) {
+					//clean(result);
+				}
+				result.clear(false);
+			}
+			else if (parent.is_array()) {
+				uint64_t last_idx_idx = obj->find(_last_idx_str);
+				if (last_idx_idx == Object::npos) {
+					//clean(result);
+					return false;
+				}
+
+				uint64_t last_idx = obj->get_value_list(last_idx_idx).uint_val();
+
+				claujson::clean(parent.as_array()->get_value_list(last_idx));
+				parent.as_array()->erase(last_idx);
+			}
+			else {
+				uint64_t last_key_idx = obj->find(_last_key_str);
+				if (last_key_idx == Object::npos) {
+					//clean(result);
+					return false;
+				}
+
+				const _Value& last_key = obj->get_value_list(last_key_idx);
+				uint64_t _idx = parent.as_object()->find(last_key);
+				claujson::clean(parent.as_object()->get_value_list(_idx));
+				parent.as_object()->erase(_idx);
+			}
+		}
+		else if (obj->get_value_list(op_idx).str_val() == "add"sv) {
+			if (value_idx == Object::npos) {
+				//clean(result);
+				return false;
+			}
+
+			std_vector<_Value> vec;
+			const Array* arr = obj->get_value_list(path_idx).as_array();
+			if (arr == nullptr) {
+				//clean(result);
+				return false;
+			}
+			for (uint64_t i = 0; i < arr->size(); ++i) {
+				vec.push_back(arr->get_value_list(i).clone());
+			}
+
+			_Value& _ = result.json_pointerB(vec);
+
+			{
+				StructuredPtr parent = _;
+
+				// case : result.json_pointer returns root?
+				if (!parent) {
+					result = obj->get_value_list(value_idx).clone();
+				}
+				else if (parent.is_array()) {
+					parent.add_array_element(obj->get_value_list(value_idx).clone());
+				}
+				else if (parent.is_object()) {
+					if (key_idx == Object::npos) {
+						//clean(result);
+						return false;
+					}
+					parent.add_object_element(obj->get_value_list(key_idx).clone(), obj->get_value_list(value_idx).clone());
+				}
+			}
+		}
+
+		return true;
+	}
 
-						j->add_element(_Value(obj));
-					}
-				}
-				else {
-					for (; i < sz_y; ++i) {
-						Object* obj = new (std::nothrow) Object();
+	// replace with path and value, (paths of a run do not contain each other -> resolved by one walk)
+	static bool is_batch_replace(const Object* obj) {
+		if (!obj) {
+			return false;
+		}
+		const uint64_t op_idx = obj->find(_op_str);
+		return op_idx != Object::npos && obj->get_value_list(op_idx).is_str() && obj->get_value_list(op_idx).str_val() == "replace"sv
+			&& obj->find(_value_str) != Object::npos && obj->find(_path_str) != Object::npos
+			&& obj->get_value_list(obj->find(_path_str)).is_array();
+	}
 
-						if (obj == nullptr) {
-							clean(result);
-							return _Value(nullptr, false);
-						}
+	_Value& patch(_Value& x, const _Value& diff) {
+		static _Value unvalid_data(nullptr, false);
 
-						obj->add_element(_op_str.clone(), _add_str.clone());
+		const Array* j_diff = diff.as_array();
 
-						{
-							Array* temp = new (std::nothrow) Array();
-							if (temp == nullptr) {
-								clean(result);
-								delete obj;
-								return _Value(nullptr, false);
-							}
-							for (uint64_t i = 0; i < route.size(); ++i) {
-								temp->add_element(route[i].clone());
-							}
-							obj->add_element(_path_str.clone(), _Value(temp));
-						}
-						//obj->add_element(_path_str.clone(), _Value(route));
+		if (!j_diff) {
+			return unvalid_data;
+		}
 
-						obj->add_element(_value_str.clone(), _Value(jy.as_array()->get_value_list(i).clone()));
+		_Value& result = x;
 
-						j->add_element(_Value(obj));
+		uint64_t sz_diff = j_diff->get_data_size();
+
+		for (uint64_t i = 0; i < sz_diff;) {
+			// run of replaces, paths are resolved together.
+			PointerBatch batch;
+			uint64_t last = i;
+			while (last < sz_diff && is_batch_replace(j_diff->get_value_list(last).as_object())) {
+				const Object* obj = j_diff->get_value_list(last).as_object();
+				bool overlap = false;
+				if (batch.add(*obj->get_value_list(obj->find(_path_str)).as_array(), &overlap) == PointerBatch::npos) {
+					break;
+				}
+				++last;
+			}
+
+			if (last - i >= 2) {
+				std_vector<_Value*> target;
+				batch.resolve(result, target);
+
+				for (uint64_t k = i; k < last; ++k) {
+					const Object* obj = j_diff->get_value_list(k).as_object();
+					if (target[k - i]) {
+						*target[k - i] = obj->get_value_list(obj->find(_value_str)).clone();
+					}
+					else if (!patch_one(result, obj)) { // not found, as before.
+						return unvalid_data;
 					}
 				}
+				i = last;
+				continue;
 			}
-			else if (jx.is_object()) {
-				uint64_t sz_x = jx.as_object()->get_data_size();
-				uint64_t sz_y = jy.as_object()->get_data_size();
 
-				for (uint64_t i = sz_x; i > 0; --i) {
-					const _Value& key = jx.as_object()->get_key_list(i - 1);
-					uint64_t idx = jy.as_object()->find(key);
-					if (idx != Object::npos) {
-						route.push_back(key.clone());
-						
-						_Value inner_diff = _diff((jx.as_object()->get_value_list(i - 1)), 
-							jy.as_object()->get_value_list(idx), route);
+			if (!patch_one(result, (const Object*)j_diff->get_value_list(i).as_object())) {
+				return unvalid_data;
+			}
+			++i;
+		}
 
-						route.pop_back();
+		return result;
+	}
 
-						{
-							Array* w = inner_diff.as_array();
-							uint64_t sz_w = w->get_data_size();
+	void clean(_Value& x) {
+		if (x.is_structured()) {
+			if (x.is_array()) {
+				delete x.as_array();
+			}
+			else if (x.is_object()) {
+				delete x.as_object();
+			}
+			else if (x.is_partial_json()) {
+				delete x.as_partial_json();
+			}
 
-							for (uint64_t t = 0; t < sz_w; ++t) {
-								_Value temp = std::move(w->get_value_list(t));
-								if (temp.is_array()) {
-									j->add_element(_Value(temp.as_array()));
-								}
-								else if (temp.is_object()) {
-									j->add_element(_Value(temp.as_object()));
-								}
-							}
+			x.set_none();
+		}
+	}
 
-							clean(inner_diff);
-						}
-					}
-					else {
-						Object* obj = new (std::nothrow) Object();
+	_Value& TreeCursor::value() {
+		if (stack.empty()) {
+			return *root;
+		}
+		return stack.back().node.get_value_list(stack.back().idx);
+	}
 
-						if (obj == nullptr) {
-							clean(result);
-							return _Value(nullptr, false);
-						}
-						obj->add_element(_op_str.clone(), _remove_str.clone());
+	const _Value& TreeCursor::key() const {
+		if (stack.empty()) {
+			return StructuredPtr::empty_value;
+		}
+		return stack.back().node.get_key_list(stack.back().idx);
+	}
 
-						{
-							Array* temp = new (std::nothrow) Array();
-							if (temp == nullptr) {
-								clean(result);
-								delete obj;
-								return _Value(nullptr, false);
-							}
-							for (uint64_t i = 0; i < route.size(); ++i) {
-								temp->add_element(route[i].clone());
-							}
-							obj->add_element(_path_str.clone(), _Value(temp));
-						}
-						
-						//obj->add_element(_path_str.clone(), _Value(route));
-						
-						obj->add_element(_last_key_str.clone(), key.clone());
+	StructuredPtr TreeCursor::parent() const {
+		if (stack.empty()) {
+			return nullptr;
+		}
+		return stack.back().node;
+	}
 
-						j->add_element(_Value(obj));
-					}
-				}
+	uint64_t TreeCursor::index() const {
+		if (stack.empty()) {
+			return 0;
+		}
+		return stack.back().idx;
+	}
 
-				for (uint64_t i = 0; i < sz_y; ++i) {
-					const _Value& key = jy.as_object()->get_key_list(i);
-					uint64_t idx = jx.as_object()->find(key);
-					if (idx == Object::npos) {
-						Object* obj = new (std::nothrow) Object();
+	bool TreeCursor::down(uint64_t idx) {
+		_Value& x = value();
+		if (!x.is_structured()) {
+			return false;
+		}
+		StructuredPtr node(x);
+		if (idx >= node.get_data_size()) {
+			return false;
+		}
+		stack.push_back({ node, idx });
+		return true;
+	}
+
+	bool TreeCursor::up() {
+		if (stack.empty()) {
+			return false;
+		}
+		stack.pop_back();
+		return true;
+	}
+
+	bool TreeCursor::next_sibling() {
+		if (stack.empty() || stack.back().idx + 1 >= stack.back().node.get_data_size()) {
+			return false;
+		}
+		++stack.back().idx;
+		return true;
+	}
+
+	bool TreeCursor::next() {
+		if (down(0)) {
+			return true;
+		}
+		while (!stack.empty()) {
+			if (next_sibling()) {
+				return true;
+			}
+			stack.pop_back();
+		}
+		return false;
+	}
+
+	Cursor::~Cursor() {
+		claujson::clean(x);
+	}
+
+	bool Cursor::enter_array() {
+		if (type() != '[') {
+			return false;
+		}
+		++i;
+		return true;
+	}
+
+	bool Cursor::enter_object() {
+		if (type() != '{') {
+			return false;
+		}
+		++i;
+		return true;
+	}
+
+	bool Cursor::next_item() {
+		if (type() == ',') {
+			++i;
+		}
+		if (type() == ']' || i >= n) {
+			++i;
+			return false;
+		}
+		return true;
+	}
+
+	bool Cursor::next_key(StringView& key) {
+		if (type() == ',') {
+			++i;
+		}
+		if (type() != '"') { // `}`
+			++i;
+			return false;
+		}
+		if (!decode()) {
+			return false;
+		}
+		key = StringView(x.get_string().data(), x.get_string().size());
+		i += 2; // pass key and `:`
+		return true;
+	}
+
+	bool Cursor::find_key(StringView key) {
+		StringView now;
+		while (next_key(now)) {
+			if (now == key) {
+				return true;
+			}
+			skip_value();
+		}
+		return false;
+	}
+
+	bool Cursor::decode() {
+		if (i >= n) {
+			return false;
+		}
+		bool err = false;
+		Convert(x, idx[i], i + 1 < n ? idx[i + 1] : buf_len, false, buf, i, err);
+		return !err;
+	}
+
+	bool Cursor::get_double(double& v) {
+		switch (type()) {
+		case '-': case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9':
+			break;
+		default:
+			return false;
+		}
+		if (!decode()) {
+			return false;
+		}
+		v = x.is_float() ? x.get_floating() : x.is_int() ? (double)x.get_integer() : (double)x.get_unsigned_integer();
+		++i;
+		return true;
+	}
+
+	bool Cursor::get_int64(int64_t& v) {
+		if (!(type() == '-' || (type() >= '0' && type() <= '9')) || !decode() || !x.is_int()) {
+			return false;
+		}
+		v = x.get_integer();
+		++i;
+		return true;
+	}
+
+	bool Cursor::get_uint64(uint64_t& v) {
+		if (!(type() >= '0' && type() <= '9') || !decode()) {
+			return false;
+		}
+		if (x.is_uint()) {
+			v = x.get_unsigned_integer();
+		}
+		else if (x.is_int()) {
+			v = x.get_integer();
+		}
+		else {
+			return false;
+		}
+		++i;
+		return true;
+	}
+
+	bool Cursor::get_bool(bool& v) {
+		if (!(type() == 't' || type() == 'f') || !decode()) {
+			return false;
+		}
+		v = x.get_boolean();
+		++i;
+		return true;
+	}
+
+	bool Cursor::get_null() {
+		if (type() != 'n' || !decode()) {
+			return false;
+		}
+		++i;
+		return true;
+	}
+
+	bool Cursor::get_string(StringView& v) {
+		if (type() != '"' || !decode()) {
+			return false;
+		}
+		v = StringView(x.get_string().data(), x.get_string().size());
+		++i;
+		return true;
+	}
+
+	void Cursor::skip_value() {
+		if (i >= n) {
+			return;
+		}
+		const char ch = buf[idx[i]];
+		i = ch == '[' || ch == '{' ? jump[i] + 1 : i + 1;
+	}
+
+	void parallel_visit(const _Value& root, const Projection& path, uint64_t parts, const std::function<void(uint64_t, const _Value&)>& f,
+		std::shared_ptr<ThreadPool> pool) {
+		if (!pool) {
+			pool = default_pool();
+		}
+		LoadData2::visit(pool.get(), root, path, parts, f);
+	}
+
+	const uint64_t JsonPointer::npos;
+
+	JsonPointer::JsonPointer(StringView str) {
+		const char* x = str.data();
+		const uint64_t len = str.size();
+
+		if (len > 0 && x[0] != '/') {
+			return;
+		}
+		for (uint64_t i = 0; i < len; ++i) {
+			if (x[i] == '/') {
+				steps.push_back({ std::string(), npos });
+			}
+			else if (x[i] == '~') {
+				if (i + 1 < len && (x[i + 1] == '0' || x[i + 1] == '1')) {
+					steps.back().key.push_back(x[i + 1] == '0' ? '~' : '/');
+					++i;
+				}
+				else {
+					steps.clear();
+					return;
+				}
+			}
+			else {
+				steps.back().key.push_back(x[i]);
+			}
+		}
 
-						if (obj == nullptr) {
-							clean(result);
-							return _Value(nullptr, false);
-						}
+		for (auto& step : steps) {
+			const std::string& key = step.key;
+			bool digits = !key.empty() && key.size() <= 19 && (key.size() == 1 || key[0] != '0');
+			for (uint64_t i = 0; digits && i < key.size(); ++i) {
+				digits = key[i] >= '0' && key[i] <= '9';
+			}
+			step.idx = digits ? std::stoull(key) : npos;
+		}
 
-						obj->add_element(_op_str.clone(), _add_str.clone());
+		slot.reset(new std::atomic<uint64_t>[steps.size()]);
+		for (uint64_t i = 0; i < steps.size(); ++i) {
+			slot[i].store(0, std::memory_order_relaxed);
+		}
+		ok = true;
+	}
 
+	JsonPointer::JsonPointer(const JsonPointer& other) : steps(other.steps), ok(other.ok) {
+		if (other.slot) {
+			slot.reset(new std::atomic<uint64_t>[steps.size()]);
+			for (uint64_t i = 0; i < steps.size(); ++i) {
+				slot[i].store(other.slot[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			}
+		}
+	}
 
-						{
-							Array* temp = new (std::nothrow) Array();
-							if (temp == nullptr) {
-								clean(result);
-								delete obj;
-								return _Value(nullptr, false);
-							}
-							for (uint64_t i = 0; i < route.size(); ++i) {
-								temp->add_element(route[i].clone());
-							}
-							obj->add_element(_path_str.clone(), _Value(temp));
-						}
-						
-						//obj->add_element(_path_str.clone(), _Value(route));
-						
-						obj->add_element(_key_str.clone(), _Value(jy.as_object()->get_key_list(i).clone()));
-						obj->add_element(_value_str.clone(), _Value(jy.as_object()->get_value_list(i).clone()));
+	JsonPointer& JsonPointer::operator=(const JsonPointer& other) {
+		if (this != &other) {
+			JsonPointer temp(other);
+			*this = std::move(temp);
+		}
+		return *this;
+	}
 
-						j->add_element(_Value(obj));
+	const _Value* JsonPointer::get(const _Value& root) const {
+		if (!ok) {
+			return nullptr;
+		}
+		const _Value* x = &root;
+		for (uint64_t k = 0; k < steps.size(); ++k) {
+			const Step& step = steps[k];
+			if (x->is_array()) {
+				const Array* arr = x->as_array();
+				if (step.idx >= arr->get_data_size()) {
+					return nullptr;
+				}
+				x = &arr->get_value_list(step.idx);
+			}
+			else if (x->is_object()) {
+				const Object* obj = x->as_object();
+				const uint64_t n = obj->get_data_size();
+				const StringView key(step.key);
+				uint64_t i = slot[k].load(std::memory_order_relaxed);
+
+				if (i >= n || !(StringView(obj->get_key_list(i).get_string().data(), obj->get_key_list(i).get_string().size()) == key)) {
+					for (i = 0; i < n; ++i) {
+						const _Value& name = obj->get_key_list(i);
+						if (StringView(name.get_string().data(), name.get_string().size()) == key) {
+							break;
+						}
 					}
+					if (i >= n) {
+						return nullptr;
+					}
+					slot[k].store(i, std::memory_order_relaxed);
 				}
+				x = &obj->get_value_list(i);
+			}
+			else {
+				return nullptr;
 			}
 		}
-		break;
+		return x;
+	}
 
-		case _ValueType::BOOL:
-		case _ValueType::NULL_:
-		case _ValueType::FLOAT:
-		case _ValueType::INT:
-		case _ValueType::UINT:
-		case _ValueType::STRING:
-		case _ValueType::SHORT_STRING:
-		{
-			Object* obj = new (std::nothrow) Object();
+	_Value* JsonPointer::get(_Value& root) const {
+		return const_cast<_Value*>(get(static_cast<const _Value&>(root)));
+	}
 
-			if (obj == nullptr) {
-				clean(result);
-				return _Value(nullptr, false);
+	const uint64_t PointerBatch::npos;
+
+	uint64_t PointerBatch::insert(const std_vector<std::string>& keys, bool* overlap) {
+		if (overlap) {
+			uint64_t node = 0;
+			for (auto& key : keys) {
+				if (!nodes[node].target.empty()) { // other is prefix.
+					*overlap = true;
+					return npos;
+				}
+				auto& child = nodes[node].child;
+				auto iter = std::lower_bound(child.begin(), child.end(), key,
+					[](const std::pair<std::string, uint64_t>& a, const std::string& b) { return a.first < b; });
+				if (iter == child.end() || iter->first != key) {
+					node = npos;
+					break;
+				}
+				node = iter->second;
 			}
+			if (node != npos && !nodes[node].child.empty()) { // prefix of other.
+				*overlap = true;
+				return npos;
+			}
+		}
 
-			obj->add_element(_op_str.clone(), _replace_str.clone());
-
-			{
-				Array* temp = new (std::nothrow) Array();
-				if (temp == nullptr) {
-					clean(result);
-					delete obj;
-					return _Value(nullptr, false);
-				}
-				for (uint64_t i = 0; i < route.size(); ++i) {
-					temp->add_element(route[i].clone());
-				}
-				obj->add_element(_path_str.clone(), _Value(temp));
+		uint64_t node = 0;
+		for (auto& key : keys) {
+			auto& child = nodes[node].child;
+			auto iter = std::lower_bound(child.begin(), child.end(), key,
+				[](const std::pair<std::string, uint64_t>& a, const std::string& b) { return a.first < b; });
+			if (iter != child.end() && iter->first == key) {
+				node = iter->second;
+				continue;
 			}
 
-			//obj->add_element(_path_str.clone(), _Value(route));
-			
-			obj->add_element(_value_str.clone(), _Value(y.clone()));
+			bool digits = !key.empty() && key.size() <= 19 && (key.size() == 1 || key[0] != '0');
+			for (uint64_t i = 0; digits && i < key.size(); ++i) {
+				digits = key[i] >= '0' && key[i] <= '9';
+			}
+			const uint64_t pos = iter - child.begin();
+			const uint64_t next = nodes.size();
+			child.insert(iter, { key, next });
+			nodes[node].idx.insert(nodes[node].idx.begin() + pos, digits ? std::stoull(key) : npos);
+			nodes.emplace_back();
+			node = next;
+		}
+		nodes[node].target.push_back(count);
+		return count++;
+	}
 
-			j->add_element(_Value(obj));
-			break;
+	uint64_t PointerBatch::add(const JsonPointer& pointer) {
+		if (!pointer.valid()) {
+			return npos;
 		}
+		std_vector<std::string> keys(pointer.size());
+		for (uint64_t i = 0; i < pointer.size(); ++i) {
+			keys[i] = pointer.key(i);
 		}
-
-		return result;
+		return insert(keys, nullptr);
 	}
 
-
-	_Value diff(const _Value& x, const _Value& y) {
-		std_vector<_Value> vec;
-		return _diff(x, y, vec);
+	uint64_t PointerBatch::add(StringView pointer) {
+		return add(JsonPointer(pointer));
 	}
 
-	_Value& patch(_Value& x, const _Value& diff) {
-		static _Value unvalid_data(nullptr, false);
+	uint64_t PointerBatch::add(const Array& route, bool* overlap) {
+		std_vector<std::string> keys(route.get_data_size());
+		for (uint64_t i = 0; i < keys.size(); ++i) {
+			const _Value& x = route.get_value_list(i);
+			if (x.is_str()) {
+				keys[i].assign(x.get_string().data(), x.get_string().size());
+			}
+			else if (x.is_uint()) {
+				keys[i] = std::to_string(x.get_unsigned_integer());
+			}
+			else {
+				return npos;
+			}
+		}
+		return insert(keys, overlap);
+	}
 
-		const Array* j_diff = diff.as_array();
+	void PointerBatch::children(const _Value& x, uint64_t node, std_vector<std::pair<const _Value*, uint64_t>>& out) const {
+		const Node& now = nodes[node];
+		out.clear();
 
-		if (!j_diff) {
-			return unvalid_data;
+		if (x.is_array()) {
+			const Array* arr = x.as_array();
+			for (uint64_t i = 0; i < now.child.size(); ++i) {
+				if (now.idx[i] < arr->get_data_size()) {
+					out.push_back({ &arr->get_value_list(now.idx[i]), now.child[i].second });
+				}
+			}
 		}
+		else if (x.is_object()) {
+			const Object* obj = x.as_object();
+			const uint64_t n = obj->get_data_size();
+			std_vector<char> done(now.child.size(), 0); // first one of same keys, as Object::find
 
-		static const _Value _op_str = _Value("op"sv);
-		static const _Value _path_str = _Value("path"sv);
-		static const _Value _value_str = _Value("value"sv);
-		static const _Value _key_str = _Value("key"sv);
-		static const _Value _last_key_str = _Value("last_key"sv);
-		static const _Value _last_idx_str = _Value("last_idx"sv);
+			for (uint64_t i = 0; i < n && out.size() < now.child.size(); ++i) {
+				const _Value& name = obj->get_key_list(i);
+				const char* key = name.get_string().data();
+				const uint64_t len = name.get_string().size();
+				auto iter = std::partition_point(now.child.begin(), now.child.end(),
+					[&](const std::pair<std::string, uint64_t>& c) { return c.first.compare(0, c.first.size(), key, len) < 0; });
+				if (iter == now.child.end() || iter->first.compare(0, iter->first.size(), key, len) != 0) {
+					continue;
+				}
+				const uint64_t k = iter - now.child.begin();
+				if (!done[k]) {
+					done[k] = 1;
+					out.push_back({ &obj->get_value_list(i), iter->second });
+				}
+			}
+		}
+	}
 
-		_Value& result = x;
+	void PointerBatch::walk(const _Value& x, uint64_t node, std_vector<const _Value*>& result) const {
+		for (auto id : nodes[node].target) {
+			result[id] = &x;
+		}
+		if (nodes[node].child.empty()) {
+			return;
+		}
+		std_vector<std::pair<const _Value*, uint64_t>> sub;
+		children(x, node, sub);
+		for (auto& y : sub) {
+			walk(*y.first, y.second, result);
+		}
+	}
 
-		uint64_t sz_diff = j_diff->get_data_size();
+	void PointerBatch::resolve(const _Value& root, std_vector<const _Value*>& result, std::shared_ptr<ThreadPool> pool) const {
+		result.assign(count, nullptr);
 
-		for (uint64_t i = 0; i < sz_diff; ++i) {
-			const Object* obj = (const Object*)j_diff->get_value_list(i).as_object();
-			uint64_t op_idx = obj->find(_op_str);
-			uint64_t path_idx = obj->find(_path_str);
-			uint64_t value_idx = obj->find(_value_str);
-			uint64_t key_idx = obj->find(_key_str);
+		if (count < 64 || nodes[0].child.size() < 2) {
+			walk(root, 0, result);
+			return;
+		}
 
-			if (op_idx == Object::npos) {
-				//clean(result);
-				return unvalid_data;
-			}
+		// top-level subtrees in parallel, they write different ids.
+		for (auto id : nodes[0].target) {
+			result[id] = &root;
+		}
+		std_vector<std::pair<const _Value*, uint64_t>> sub;
+		children(root, 0, sub);
 
-			if (path_idx == Object::npos) {
-				//clean(result);
-				return unvalid_data;
-			}
+		if (!pool) {
+			pool = default_pool();
+		}
+		pool->parallel_for(0, sub.size(), 1, [&](uint64_t i) {
+			walk(*sub[i].first, sub[i].second, result);
+		});
+	}
 
-			if (obj->get_value_list(op_idx).str_val() == "replace"sv) {
-				if (value_idx == Object::npos) {
-					//clean(result);
-					return unvalid_data;
-				}
+	void PointerBatch::resolve(_Value& root, std_vector<_Value*>& result, std::shared_ptr<ThreadPool> pool) const {
+		std_vector<const _Value*> temp;
+		resolve(static_cast<const _Value&>(root), temp, std::move(pool));
+		result.resize(temp.size());
+		for (uint64_t i = 0; i < temp.size(); ++i) {
+			result[i] = const_cast<_Value*>(temp[i]);
+		}
+	}
 
-				std_vector<_Value> vec;
-				const Array* arr = obj->get_value_list(path_idx).as_array();
-				if (arr == nullptr) {
-					//clean(result);
-					return unvalid_data;
+	// value at key path of column from record, slot : cache of positions, one per key.
+	static claujson_inline const _Value* column_value(const _Value& record, const std_vector<StringView>& key, uint64_t* slot) {
+		const _Value* x = &record;
+		for (uint64_t k = 0; k < key.size(); ++k) {
+			if (!x->is_object()) {
+				return nullptr;
+			}
+			const Object* obj = x->as_object();
+			const uint64_t n = obj->get_data_size();
+			uint64_t i = slot[k];
+
+			if (i >= n || !(StringView(obj->get_key_list(i).get_string().data(), obj->get_key_list(i).get_string().size()) == key[k])) {
+				for (i = 0; i < n; ++i) {
+					const _Value& name = obj->get_key_list(i);
+					if (StringView(name.get_string().data(), name.get_string().size()) == key[k]) {
+						break;
+					}
 				}
-				for (uint64_t i = 0; i < arr->size(); ++i) {
-					vec.push_back(arr->get_value_list(i).clone());
+				if (i >= n) {
+					return nullptr;
 				}
-				_Value& value = result.json_pointerB(vec);
-
-				value = obj->get_value_list(value_idx).clone(); // clone -> std::move(~~)??
+				slot[k] = i;
 			}
-			else if (obj->get_value_list(op_idx).str_val() == "remove"sv) {
-				std_vector<_Value> vec;
-				const Array* arr = obj->get_value_list(path_idx).as_array();
-				if (arr == nullptr) {
-					//clean(result);
-					return unvalid_data;
-				}
-				for (uint64_t i = 0; i < arr->size(); ++i) {
-					vec.push_back(arr->get_value_list(i).clone());
-				}
-				_Value& value = result.json_pointerB(vec);
-				_Value& parent = value;
+			x = &obj->get_value_list(i);
+		}
+		return x;
+	}
 
-				// case : result.json_pointer returns root?
-				if (!parent) {
-					if (result.is_structured()) {
-						//clean(result);
+	// true if x has the type of column, then set at row.
+	static claujson_inline bool column_set(Column& column, uint64_t row, const _Value& x) {
+		switch (column.type) {
+		case Column::Type::DOUBLE:
+			if (x.is_float()) { column.f64[row] = x.get_floating(); }
+			else if (x.is_int()) { column.f64[row] = (double)x.get_integer(); }
+			else if (x.is_uint()) { column.f64[row] = (double)x.get_unsigned_integer(); }
+			else { return false; }
+			return true;
+		case Column::Type::INT64:
+			if (x.is_int()) { column.i64[row] = x.get_integer(); }
+			else if (x.is_uint() && x.get_unsigned_integer() <= (uint64_t)std::numeric_limits<int64_t>::max()) { column.i64[row] = (int64_t)x.get_unsigned_integer(); }
+			else { return false; }
+			return true;
+		case Column::Type::UINT64:
+			if (x.is_uint()) { column.u64[row] = x.get_unsigned_integer(); }
+			else if (x.is_int() && x.get_integer() >= 0) { column.u64[row] = (uint64_t)x.get_integer(); }
+			else { return false; }
+			return true;
+		case Column::Type::BOOL:
+			if (!x.is_bool()) { return false; }
+			column.b[row] = x.get_boolean() ? 1 : 0;
+			return true;
+		}
+		return false;
+	}
+
+	void extract_columns(const Array& records, std_vector<Column>& columns, std::shared_ptr<ThreadPool> pool) {
+		if (!pool) {
+			pool = default_pool();
+		}
+		const uint64_t rows = records.get_data_size();
+		const uint64_t words = (rows + 63) / 64;
+
+		std_vector<std_vector<StringView>> keys(columns.size());
+		for (uint64_t c = 0; c < columns.size(); ++c) {
+			Column& column = columns[c];
+			column.f64.clear(); column.i64.clear(); column.u64.clear(); column.b.clear();
+			switch (column.type) {
+			case Column::Type::DOUBLE: column.f64.resize(rows, 0); break;
+			case Column::Type::INT64: column.i64.resize(rows, 0); break;
+			case Column::Type::UINT64: column.u64.resize(rows, 0); break;
+			case Column::Type::BOOL: column.b.resize(rows, 0); break;
+			}
+			column.valid.assign(words, 0);
+			for (auto& k : column.key) {
+				keys[c].push_back(StringView(k));
+			}
+		}
+
+		// slices of 64 rows, so a word of valid is written by one thread.
+		const uint64_t parts = std::min<uint64_t>(words, (pool->size() + 1) * 4);
+		pool->parallel_for(0, parts, 1, [&](uint64_t part) {
+			const uint64_t first = words * part / parts * 64;
+			const uint64_t last = std::min(rows, words * (part + 1) / parts * 64);
+			std_vector<std_vector<uint64_t>> slot(columns.size());
+			for (uint64_t c = 0; c < columns.size(); ++c) {
+				slot[c].assign(keys[c].size(), 0);
+			}
+
+			for (uint64_t row = first; row < last; ++row) {
+				const _Value& record = records.get_value_list(row);
+				for (uint64_t c = 0; c < columns.size(); ++c) {
+					const _Value* x = column_value(record, keys[c], slot[c].data());
+					if (x && column_set(columns[c], row, *x)) {
+						columns[c].valid[row / 64] |= uint64_t(1) << (row % 64);
 					}
-					result.clear(false);
 				}
-				else if (parent.is_array()) {
-					uint64_t last_idx_idx = obj->find(_last_idx_str);
-					if (last_idx_idx == Object::npos) {
-						//clean(result);
-						return unvalid_data;
-					}
+			}
+		});
 
-					uint64_t last_idx = obj->get_value_list(last_idx_idx).uint_val();
+		for (auto& column : columns) {
+			uint64_t count = 0;
+			for (auto w : column.valid) {
+				count += std::bitset<64>(w).count();
+			}
+			column.null_count = rows - count;
+		}
+	}
 
-					claujson::clean(parent.as_array()->get_value_list(last_idx));
-					parent.as_array()->erase(last_idx);
+	bool Projection::add(StringView path) {
+		std_vector<std::pair<std::string, bool>> steps; // name, is `*`
+		const char* str = path.data();
+		const uint64_t len = path.size();
+		uint64_t i = 0;
+
+		if (len > 0 && str[0] == '/') { // JSON Pointer, ~0 -> `~`, ~1 -> `/`
+			std::string name;
+			for (i = 1; i <= len; ++i) {
+				if (i == len || str[i] == '/') {
+					const bool any = name == "*";
+					steps.push_back({ std::move(name), any });
+					name.clear();
+				}
+				else if (str[i] == '~') {
+					if (i + 1 < len && (str[i + 1] == '0' || str[i + 1] == '1')) {
+						name.push_back(str[i + 1] == '0' ? '~' : '/');
+						++i;
+					}
+					else {
+						return false;
+					}
 				}
 				else {
-					uint64_t last_key_idx = obj->find(_last_key_str);
-					if (last_key_idx == Object::npos) {
-						//clean(result);
-						return unvalid_data;
-					}
-
-					const _Value& last_key = obj->get_value_list(last_key_idx);
-					uint64_t _idx = parent.as_object()->find(last_key);
-					claujson::clean(parent.as_object()->get_value_list(_idx));
-					parent.as_object()->erase(_idx);
+					name.push_back(str[i]);
 				}
 			}
-			else if (obj->get_value_list(op_idx).str_val() == "add"sv) {
-				if (value_idx == Object::npos) {
-					//clean(result);
-					return unvalid_data;
-				}
-
-				std_vector<_Value> vec;
-				const Array* arr = obj->get_value_list(path_idx).as_array();
-				if (arr == nullptr) {
-					//clean(result);
-					return unvalid_data;
-				}
-				for (uint64_t i = 0; i < arr->size(); ++i) {
-					vec.push_back(arr->get_value_list(i).clone());
+		}
+		else { // $.a.b[0]["c"][*]
+			if (len > 0 && str[0] == '$') {
+				i = 1;
+			}
+			while (i < len) {
+				if (str[i] == '[') {
+					uint64_t last = i + 1;
+					if (last < len && (str[last] == '\'' || str[last] == '"')) { // quoted key, no escape.
+						const char q = str[last];
+						++last;
+						while (last < len && str[last] != q) {
+							++last;
+						}
+						if (last + 1 >= len || str[last + 1] != ']') {
+							return false;
+						}
+						steps.push_back({ std::string(str + i + 2, last - i - 2), false });
+						i = last + 2;
+					}
+					else {
+						while (last < len && str[last] != ']') {
+							++last;
+						}
+						if (last >= len || last == i + 1) {
+							return false;
+						}
+						std::string name(str + i + 1, last - i - 1);
+						const bool any = name == "*";
+						steps.push_back({ std::move(name), any });
+						i = last + 1;
+					}
 				}
-
-				_Value& _ = result.json_pointerB(vec);
-
-				{
-					StructuredPtr parent = _;
-
-					// case : result.json_pointer returns root?
-					if (!parent) {
-						result = obj->get_value_list(value_idx).clone();
+				else {
+					if (str[i] == '.') {
+						++i;
 					}
-					else if (parent.is_array()) {
-						parent.add_array_element(obj->get_value_list(value_idx).clone());
+					else if (i > 0) { // `.` or `[` is needed.
+						return false;
 					}
-					else if (parent.is_object()) {
-						if (key_idx == Object::npos) {
-							//clean(result);
-							return unvalid_data;
-						}
-						parent.add_object_element(obj->get_value_list(key_idx).clone(), obj->get_value_list(value_idx).clone());
+					uint64_t last = i;
+					while (last < len && str[last] != '.' && str[last] != '[') {
+						++last;
+					}
+					if (last == i) {
+						return false;
 					}
+					std::string name(str + i, last - i);
+					const bool any = name == "*";
+					steps.push_back({ std::move(name), any });
+					i = last;
 				}
 			}
 		}
 
-		return result;
+		uint64_t node = 0;
+		for (auto& x : steps) {
+			if (x.second) {
+				if (nodes[node].any < 0) {
+					nodes[node].any = nodes.size();
+					nodes.emplace_back();
+				}
+				node = nodes[node].any;
+				continue;
+			}
+			uint64_t next = 0;
+			for (auto& c : nodes[node].child) {
+				if (c.first == x.first) {
+					next = c.second;
+					break;
+				}
+			}
+			if (next == 0) {
+				next = nodes.size();
+				nodes[node].child.push_back({ std::move(x.first), next });
+				nodes.emplace_back();
+			}
+			node = next;
+		}
+		nodes[node].leaf = true;
+		return true;
 	}
 
-	void clean(_Value& x) {
-		if (x.is_structured()) {
-			if (x.is_array()) {
-				delete x.as_array();
-			}
-			else if (x.is_object()) {
-				delete x.as_object();
+	void Projection::step(const std_vector<uint64_t>& state, StringView name, bool named, std_vector<uint64_t>& next, bool& leaf) const {
+		leaf = false;
+		for (auto x : state) {
+			const Node& node = nodes[x];
+			if (named) {
+				for (auto& c : node.child) {
+					if (StringView(c.first) == name) {
+						next.push_back(c.second);
+						leaf = leaf || nodes[c.second].leaf;
+					}
+				}
 			}
-			else if (x.is_partial_json()) {
-				delete x.as_partial_json();
+			if (node.any >= 0) {
+				next.push_back(node.any);
+				leaf = leaf || nodes[node.any].leaf;
 			}
+		}
+	}
 
-			x.set_none();
+	static std::mutex default_pool_mutex;
+	static std::shared_ptr<ThreadPool> _default_pool;
+
+	std::shared_ptr<ThreadPool> default_pool() {
+		std::lock_guard<std::mutex> lock(default_pool_mutex);
+		if (!_default_pool) {
+			_default_pool = std::make_shared<ThreadPool>(std::max((int)std::thread::hardware_concurrency() - 2, 1));
 		}
+		return _default_pool;
+	}
+
+	void set_default_pool(std::shared_ptr<ThreadPool> pool) {
+		std::lock_guard<std::mutex> lock(default_pool_mutex);
+		_default_pool = std::move(pool);
 	}
 
 	[[nodiscard]]
-	std::unique_ptr<ThreadPool> pool_init(int thr_num) {
+	std::shared_ptr<ThreadPool> pool_init(int thr_num) {
 		if (thr_num <= 0) {
-			thr_num = std::max((int)std::thread::hardware_concurrency() - 2, 1);
+			return default_pool();
+		}
 
+		return std::make_shared<ThreadPool>(thr_num);
+	}
+
+	static uint64_t best_threads(double work, double ns_per_task, uint64_t max_thr) {
+		if (max_thr < 1) {
+			max_thr = 1;
 		}
-		if (thr_num <= 0) {
-			thr_num = 1;
+		if (ns_per_task <= 0) {
+			return max_thr;
 		}
+		const double t = std::sqrt(std::max(work, 0.0) / ns_per_task);
+		if (t < 1.5) {
+			return 1;
+		}
+		return std::min(max_thr, static_cast<uint64_t>(t + 0.5));
+	}
+
+	uint64_t CostModel::parse_threads(uint64_t tokens, uint64_t bytes, uint64_t max_thr) const {
+		return best_threads(tokens * ns_per_token + bytes * ns_per_byte, ns_per_task, max_thr);
+	}
+
+	uint64_t CostModel::write_threads(uint64_t values, uint64_t max_thr) const {
+		return best_threads(values * ns_per_value, ns_per_task, max_thr);
+	}
+
+	// median of 3, after warm up.
+	template <class F>
+	static double measure_ns(F f) {
+		f();
+		double x[3];
+		for (int i = 0; i < 3; ++i) {
+			auto a = std::chrono::steady_clock::now();
+			f();
+			auto b = std::chrono::steady_clock::now();
+			x[i] = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count();
+		}
+		std::sort(x, x + 3);
+		return x[1];
+	}
+
+	CostModel CostModel::calibrate(std::shared_ptr<ThreadPool> pool) {
+		if (!pool) {
+			pool = default_pool();
+		}
+
+		CostModel model;
+
+		// many small tokens, and few long strings.
+		std::string tokens_doc = "[";
+		for (int i = 0; i < 100000; ++i) {
+			if (i > 0) { tokens_doc += ','; }
+			tokens_doc += std::to_string(i % 10);
+		}
+		tokens_doc += "]";
+
+		std::string bytes_doc = "[";
+		const std::string long_str = "\"" + std::string(1000, 'a') + "\"";
+		for (int i = 0; i < 1000; ++i) {
+			if (i > 0) { bytes_doc += ','; }
+			bytes_doc += long_str;
+		}
+		bytes_doc += "]";
+
+		parser p(pool);
+		writer w(pool);
+		Document d;
+
+		const double k1 = 100001 + 100000, b1 = (double)tokens_doc.size(); // structural indexes ~ values + commas.
+		const double k2 = 1001 + 1000, b2 = (double)bytes_doc.size();
+
+		const double t1 = measure_ns([&]() { p.parse_str(tokens_doc, d, 1); });
+		const double t2 = measure_ns([&]() { p.parse_str(bytes_doc, d, 1); });
+
+		// t1 = k1 * x + b1 * y, t2 = k2 * x + b2 * y
+		const double det = k1 * b2 - k2 * b1;
+		if (det != 0) {
+			model.ns_per_token = std::max(0.0, (t1 * b2 - t2 * b1) / det);
+			model.ns_per_byte = std::max(0.0, (k1 * t2 - k2 * t1) / det);
+		}
+
+		if (!p.parse_str(tokens_doc, d, 1).first) {
+			return CostModel();
+		}
+		const double tw = measure_ns([&]() { w.write_to_str(d.Get()); });
+		model.ns_per_value = tw / 100001;
+
+		// overhead, from same work with t threads.
+		const uint64_t t = std::max<uint64_t>(2, pool->size());
+		const double tp = measure_ns([&]() { p.parse_str(tokens_doc, d, t); });
+		model.ns_per_task = std::max(1000.0, (tp - t1 / t) / t);
+
+		log << info << "cost model : " << model.ns_per_token << "ns/token " << model.ns_per_byte << "ns/byte "
+			<< model.ns_per_value << "ns/value " << model.ns_per_task << "ns/task\n";
+
+		return model;
+	}
+
+	static std::mutex cost_model_mutex;
+	static CostModel _cost_model;
+
+	CostModel cost_model() {
+		std::lock_guard<std::mutex> lock(cost_model_mutex);
+		return _cost_model;
+	}
 
-		return std::make_unique<ThreadPool>(thr_num);
+	void set_cost_model(const CostModel& model) {
+		std::lock_guard<std::mutex> lock(cost_model_mutex);
+		_cost_model = model;
 	}
 
 
@@ -7,6 +7,8 @@
 
 #include "thread_pool.h"
 
+#include <unordered_map>
+
 #include "_simdjson.h" // modified simdjson // using simdjson 3.9.1
 
 namespace claujson {
@@ -19,6 +21,7 @@ namespace claujson {
 		Pointer() {}
 		// left_op : 1bit
 		// right_op : 2bit
+		// mid_op : 1bit, (bit 2) set by set_mid_type only.
 		Pointer(void* ptr, uint8_t left_op, uint8_t right_op) {
 			uint64_t value = (uint64_t)ptr;
 			if (left_op) {
@@ -38,19 +41,65 @@ namespace claujson {
 			uint64_t value = (uint64_t)ptr;
 			return value & 3;
 		}
+		int mid_type() const {
+			uint64_t value = (uint64_t)ptr;
+			return (value & 4) ? 1 : 0;
+		}
+		void set_mid_type(int x) {
+			uint64_t value = (uint64_t)ptr;
+			value = x ? (value | 4) : (value & ~(uint64_t)4);
+			this->ptr = (void*)value;
+		}
+		// bit 62, set by Document::freeze.
+		bool frozen_type() const {
+			uint64_t value = (uint64_t)ptr;
+			return value & 0x4000000000000000;
+		}
+		void set_frozen_type() {
+			uint64_t value = (uint64_t)ptr;
+			this->ptr = (void*)(value | 0x4000000000000000);
+		}
 		void* use() {
 			uint64_t value = (uint64_t)ptr;
-			value = value & 0x7FFFFFFFFFFFFC;
+			value = value & 0x7FFFFFFFFFFFF8;
 			return (void*)value;
 		}
 		const void* use() const {
 			uint64_t value = (uint64_t)ptr;
-			value = value & 0x7FFFFFFFFFFFFC;
+			value = value & 0x7FFFFFFFFFFFF8;
 			return (void*)value;
 		}
 	};
 
 
+	// FNV-1a, for Key.
+	constexpr uint64_t key_hash(const char* str, uint64_t len) {
+		uint64_t h = 14695981039346656037ULL;
+		for (uint64_t i = 0; i < len; ++i) {
+			h = (h ^ (uint8_t)str[i]) * 1099511628211ULL;
+		}
+		return h;
+	}
+
+	// key of object, length and hash at compile time, no allocation.
+	//  (ex) static constexpr claujson::Key name("name"); obj[name]
+	class Key {
+	private:
+		const char* str;
+		uint64_t len;
+		uint64_t h;
+	public:
+		template <size_t N>
+		explicit constexpr Key(const char(&str)[N]) : str(str), len(N - 1), h(key_hash(str, N - 1)) { }
+		explicit constexpr Key(const char* str, uint64_t len) : str(str), len(len), h(key_hash(str, len)) { }
+
+		constexpr const char* data() const { return str; }
+		constexpr uint64_t size() const { return len; }
+		constexpr uint64_t hash() const { return h; }
+
+		StringView view() const { return StringView(str, len); }
+	};
+
 	class _Value;
 	class Array;
 	class Object;
@@ -249,10 +298,16 @@ namespace claujson {
 		const StructuredPtr as_structured_ptr()const;
 
 		uint64_t find(const _Value& key) const; // find without key`s converting?
+		uint64_t find(StringView key) const; // key is not converted, no allocation.
+		uint64_t find(const Key& key) const;
 
 		// _Value (type is String or Short_String) -> no need utf8, unicode check.
 		_Value& operator[](const _Value& key); // if not exist key, then nothing.
 		const _Value& operator[](const _Value& key) const; // if not exist key, then nothing.
+		_Value& operator[](StringView key);
+		const _Value& operator[](StringView key) const;
+		_Value& operator[](const Key& key);
+		const _Value& operator[](const Key& key) const;
 
 
 		_Value& operator[](uint64_t idx);
@@ -398,12 +453,19 @@ namespace claujson {
 
 	class parser;
 
+	// byte spans of arrays and objects in the input, [first, second). (ParseOption::keep_source)
+	class SourceSpans {
+	public:
+		std::string source;
+		std::unordered_map<const void*, std::pair<uint64_t, uint64_t>> span;
+	};
+
 	class Document {
 	public:
 		friend class parser;
 	private:
 		_Value x;
-
+		std::unique_ptr<SourceSpans> spans;
 	public:
 		Document() noexcept { }
 
@@ -412,7 +474,7 @@ namespace claujson {
 		}
 
 
-		Document(Document&& d) noexcept : x(std::move(d.x)) {}
+		Document(Document&& d) noexcept : x(std::move(d.x)), spans(std::move(d.spans)), frozen(d.frozen), parents(d.parents) {}
 
 		~Document() noexcept;
 	public:
@@ -421,6 +483,22 @@ namespace claujson {
 	public:
 		_Value& Get() noexcept { return x; }
 		const _Value& Get() const noexcept { return x; }
+
+		// nullptr if not parsed with ParseOption::keep_source.
+		const SourceSpans* source_spans() const noexcept { return spans.get(); }
+
+		// false if parsed with ParseOption::keep_parent = false, (then get_parent() of parsed values returns nullptr)
+		bool has_parent() const noexcept { return parents; }
+
+		// concurrency : const access from many threads is safe while no thread changes the tree.
+		//  freeze() makes that permanent, structural changes of arrays and objects (add, insert, erase, clear, change_key)
+		//  are ignored (false is returned), and then objects build a key index at first lookup and publish it with an atomic,
+		//  so concurrent lookups do not lock. values changed through _Value& are not checked, do not.
+		void freeze();
+		bool is_frozen() const noexcept { return frozen; }
+	private:
+		bool frozen = false;
+		bool parents = true;
 	};
 }
 
@@ -432,6 +510,7 @@ namespace claujson {
 		friend class _Value;
 		friend class Array;
 		friend class Object;
+		friend class Document;
 
 		static const uint64_t npos;
 		static _Value empty_value;
@@ -536,6 +615,11 @@ namespace claujson {
 
 		void null_parent();
 
+		// not changed after parsing, (ParseOption::keep_source)
+		bool is_clean() const;
+		// for changes through _Value& (ex. operator[]), marks also parents.
+		void mark_dirty();
+
 		bool is_array() const {
 			return type == 1;
 		}
@@ -613,11 +697,11 @@ namespace claujson {
 			char* buf, uint64_t val_token_idx);
 
 		void add_user_type(int64_t key_buf_idx, int64_t key_next_buf_idx, char* buf,
-			_ValueType type, uint64_t key_token_idx
+			_ValueType type, uint64_t key_token_idx, bool parent
 		);
 
 		//
-		void add_user_type(_ValueType type
+		void add_user_type(_ValueType type, bool parent
 		); // int type -> enum?
 	public:
 
@@ -626,10 +710,13 @@ namespace claujson {
 		// private: + friend?
 	private:
 		void set_parent(StructuredPtr p);
+		void set_clean();
+		void set_frozen();
 	};
 
 	class LoadData;
 	class LoadData2;
+	class Sink;
 
 	class Array;
 	class Object;
@@ -642,40 +729,560 @@ namespace claujson {
 
 namespace claujson {
 
+	class ParseOption {
+	public:
+		// keep input and byte spans of arrays and objects, for writer::write_incremental.
+		bool keep_source = false;
+		// false -> no parent stores while parsing, get_parent() returns nullptr. (use TreeCursor)
+		//  write_parallel works as write_parallel2. ignored with keep_source, (mark_dirty needs parents)
+		bool keep_parent = true;
+		// keep matching `]` or `}` of each `[` or `{` in tokens, parser::match and parser::skip.
+		bool keep_jump = false;
+	};
+
+	// paths to build with parser::parse(.., Projection, ..), other values are skipped.
+	//  "/features/*/geometry/coordinates" (JSON Pointer) or "features[*].geometry.coordinates", "$.a[0].b"
+	//  `*` is any key or index, "" or "$" is whole document. arrays are compacted, (see parser::parse)
+	class Projection {
+	public:
+		friend class LoadData2;
+	private:
+		struct Node {
+			std_vector<std::pair<std::string, uint64_t>> child; // name -> idx of node
+			int64_t any = -1;
+			bool leaf = false;
+		};
+		std_vector<Node> nodes{ Node() }; // nodes[0] is root.
+	public:
+		// false if `path` is not valid.
+		bool add(StringView path);
+
+		bool empty() const { return nodes.size() == 1 && !nodes[0].leaf; }
+		bool all() const { return nodes[0].leaf; }
+	private:
+		// nodes after `name` from nodes in `state`, leaf = true if one of them is end of a path.
+		//  named = false -> only `*` (items of array, when no node has names)
+		void step(const std_vector<uint64_t>& state, StringView name, bool named, std_vector<uint64_t>& next, bool& leaf) const;
+	};
+
+	// walk with own stack of containers, does not use get_parent().
+	class TreeCursor {
+	private:
+		struct Level {
+			StructuredPtr node;
+			uint64_t idx;
+		};
+		_Value* root;
+		std_vector<Level> stack; // stack.back().node is parent of now.
+	public:
+		explicit TreeCursor(_Value& root) : root(&root) { }
+
+		_Value& value();
+		const _Value& key() const; // not valid if in array or at root.
+		StructuredPtr parent() const; // nullptr at root.
+		uint64_t index() const; // in parent.
+		uint64_t depth() const { return stack.size(); }
+
+		bool down(uint64_t idx = 0); // to child `idx` of now.
+		bool up();
+		bool next_sibling();
+		bool next(); // pre-order, false at end. (now is root)
+	};
+
+	// open array or object at start of a chunk of parser::parse_sax, from root.
+	class SaxLevel {
+	public:
+		bool is_object = false;
+		uint64_t index = 0; // item where the chunk starts, (last level : next item)
+		std::string key; // key of that item, empty at last level.
+	};
+
+	// events of parser::parse_sax, one handler per chunk. return false -> stop parsing.
+	//  a chunk can end arrays and objects started in other chunks.
+	class SaxHandler {
+	public:
+		virtual ~SaxHandler() { }
+	public:
+		virtual bool begin(const std_vector<SaxLevel>& /*path*/) { return true; } // path is empty for first chunk.
+		virtual bool start_object() { return true; }
+		virtual bool end_object() { return true; }
+		virtual bool start_array() { return true; }
+		virtual bool end_array() { return true; }
+		virtual bool key(const _Value& /*x*/) { return true; } // string.
+		virtual bool value(const _Value& /*x*/) { return true; } // string, number, bool or null.
+		virtual bool end() { return true; } // after last event of the chunk.
+	};
+
+	// forward-only cursor over tokens of parser::parse_cursor, values are decoded only when asked.
+	//  valid until next parse of the parser. (ex) enter_object(), while (next_key(k)) { .. get_double(v) or skip_value() .. }
+	class Cursor {
+	private:
+		char* buf = nullptr;
+		uint64_t buf_len = 0;
+		const uint32_t* idx = nullptr;
+		const uint64_t* jump = nullptr;
+		uint64_t n = 0; // number of tokens.
+		uint64_t i = 0; // now.
+		_Value x; // last decoded value or key, reused.
+	public:
+		Cursor() { }
+		Cursor(char* buf, uint64_t buf_len, const uint32_t* idx, const uint64_t* jump, uint64_t n)
+			: buf(buf), buf_len(buf_len), idx(idx), jump(jump), n(n) {
+			//
+		}
+		Cursor(Cursor&& other) = default;
+		Cursor& operator=(Cursor&& other) = default;
+		~Cursor();
+	public:
+		bool at_end() const { return i >= n; }
+		// first char of now, `[`, `{`, `"`, `t`, `f`, `n`, `-` or digit, (`]`, `}` at end of array or object) 0 at end.
+		char type() const { return i < n ? buf[idx[i]] : 0; }
+		uint64_t token() const { return i; }
+
+		bool enter_array(); // now is `[` -> in array, then next_item.
+		bool enter_object(); // now is `{` -> in object, then next_key.
+		// to next item, false at `]` (and go after it)
+		bool next_item();
+		// to value of next key, false at `}` (and go after it). key is valid until next call.
+		bool next_key(StringView& key);
+		// next_key and skip_value until `key`, false at `}`.
+		bool find_key(StringView key);
+
+		// value at now and go to next, false if type is different. (and not moved)
+		bool get_double(double& v); // also int and uint.
+		bool get_int64(int64_t& v);
+		bool get_uint64(uint64_t& v);
+		bool get_bool(bool& v);
+		bool get_null();
+		bool get_string(StringView& v); // valid until next call.
+
+		// one jump for array or object.
+		void skip_value();
+	private:
+		bool decode();
+	};
+
+	// layout of pretty output, for writer and parser::reformat. (pretty = true -> default)
+	class PrettyOption {
+	public:
+		uint32_t indent = 1; // per level.
+		char indent_char = '\t'; // or ' '
+		bool compact_scalar_array = false; // [1, 2, 3] in one line, if no array or object in it.
+		bool crlf = false; // newline is "\r\n"
+		bool newline_at_end = false;
+	};
+
+	// pool for parsers and writers made without thr_num, (hardware_concurrency - 2 threads)
+	//  made at first use. thr_num of each call is a limit of how many threads it uses.
+	std::shared_ptr<ThreadPool> default_pool();
+	// replace default pool, for parsers and writers made after this.
+	void set_default_pool(std::shared_ptr<ThreadPool> pool);
+
+	// cost of one call ~ work / t + ns_per_task * t, -> t = sqrt(work / ns_per_task).
+	//  used when thr_num <= 0, limit is size of pool.
+	class CostModel {
+	public:
+		double ns_per_token = 15; // stage2, per structural index.
+		double ns_per_byte = 0.5; // strings and numbers.
+		double ns_per_value = 20; // writer, per value in tree.
+		double ns_per_task = 30000; // split, start, join, merge.
+
+		uint64_t parse_threads(uint64_t tokens, uint64_t bytes, uint64_t max_thr) const;
+		uint64_t write_threads(uint64_t values, uint64_t max_thr) const;
+
+		// measure with small documents, (takes some ms) pool = nullptr -> default_pool().
+		static CostModel calibrate(std::shared_ptr<ThreadPool> pool = nullptr);
+	};
+
+	// global model, default values or set by user. (ex) set_cost_model(CostModel::calibrate());
+	CostModel cost_model();
+	void set_cost_model(const CostModel& model);
+
+	// f(i, x) for items of arr in parallel, pool = nullptr -> default_pool(). calling thread takes part.
+	//  free threads take small ranges of items, so big and small subtrees are balanced.
+	template <class F>
+	void parallel_for_each(Array& arr, F&& f, std::shared_ptr<ThreadPool> pool = nullptr) {
+		if (!pool) {
+			pool = default_pool();
+		}
+		const uint64_t n = arr.get_data_size();
+		const uint64_t grain = std::max<uint64_t>(1, n / ((pool->size() + 1) * 16));
+		pool->parallel_for(0, n, grain, [&](uint64_t i) {
+			f(i, arr.get_value_list(i));
+		});
+	}
+
+	// f(part, x) for each value at `path` from root, (part < parts) a part runs in one thread at a time.
+	//  parts are split by position, values of part i come before values of part i + 1 in document order.
+	void parallel_visit(const _Value& root, const Projection& path, uint64_t parts, const std::function<void(uint64_t, const _Value&)>& f,
+		std::shared_ptr<ThreadPool> pool = nullptr);
+
+	// acc = op(acc, x) for each value at `path`, from init in each part, then combine(a, b) of parts in order.
+	//  init is used for all parts, so it must be identity of combine. (ex) 0, op : acc + x.get_floating(), combine : a + b
+	template <class T, class Op, class Combine>
+	T parallel_reduce(const _Value& root, const Projection& path, T init, Op op, Combine combine, std::shared_ptr<ThreadPool> pool = nullptr) {
+		if (!pool) {
+			pool = default_pool();
+		}
+		const uint64_t parts = (pool->size() + 1) * 4;
+		std_vector<T> acc(parts, init);
+
+		parallel_visit(root, path, parts, [&](uint64_t part, const _Value& x) {
+			acc[part] = op(std::move(acc[part]), x);
+		}, pool);
+
+		T result = std::move(acc[0]);
+		for (uint64_t i = 1; i < parts; ++i) {
+			result = combine(std::move(result), std::move(acc[i]));
+		}
+		return result;
+	}
+
+	// one field of records for extract_columns. rows without the field, or with other type -> null (0, not valid)
+	//  DOUBLE takes also int and uint, INT64 and UINT64 take each other if in range.
+	class Column {
+	public:
+		enum class Type { DOUBLE, INT64, UINT64, BOOL };
+	public:
+		std_vector<std::string> key; // from record, ex) { "properties", "BLKLOT" }
+		Type type = Type::DOUBLE;
+
+		// result, one of them by type.
+		std_vector<double> f64;
+		std_vector<int64_t> i64;
+		std_vector<uint64_t> u64;
+		std_vector<uint8_t> b; // 0 or 1
+		std_vector<uint64_t> valid; // bit (row % 64) of valid[row / 64]
+		uint64_t null_count = 0;
+	public:
+		Column() { }
+		Column(std::string key, Type type) : key{ std::move(key) }, type(type) { }
+		Column(std_vector<std::string> key, Type type) : key(std::move(key)), type(type) { }
+
+		bool is_valid(uint64_t row) const { return (valid[row / 64] >> (row % 64)) & 1; }
+	};
+
+	// RFC 6901 pointer, parsed once. each step keeps slot of the last matched key, (relaxed atomic)
+	//  so same pointer on records with same layout needs no find. can be shared by threads.
+	class JsonPointer {
+	private:
+		struct Step {
+			std::string key;
+			uint64_t idx; // as array index, npos if not a valid index.
+		};
+		std_vector<Step> steps;
+		std::unique_ptr<std::atomic<uint64_t>[]> slot; // one per step.
+		bool ok = false;
+	public:
+		static const uint64_t npos = (uint64_t)-1;
+
+		JsonPointer() { }
+		explicit JsonPointer(StringView str); // "" -> root, valid() is false if str is not a json pointer.
+		JsonPointer(const JsonPointer& other);
+		JsonPointer(JsonPointer&& other) = default;
+		JsonPointer& operator=(const JsonPointer& other);
+		JsonPointer& operator=(JsonPointer&& other) = default;
+	public:
+		bool valid() const { return ok; }
+		uint64_t size() const { return steps.size(); }
+		const std::string& key(uint64_t i) const { return steps[i].key; } // unescaped.
+
+		// nullptr if not found.
+		_Value* get(_Value& root) const;
+		const _Value* get(const _Value& root) const;
+	};
+
+	// many pointers on one document, steps shared by pointers with same prefix are done once.
+	//  resolve walks the document once, top-level subtrees in parallel for large batches.
+	class PointerBatch {
+	private:
+		struct Node {
+			std_vector<std::pair<std::string, uint64_t>> child; // sorted by key, -> node
+			std_vector<uint64_t> idx; // child[i].first as array index, or npos
+			std_vector<uint64_t> target; // ids of pointers ending here.
+		};
+		std_vector<Node> nodes{ Node() };
+		uint64_t count = 0;
+	public:
+		static const uint64_t npos = (uint64_t)-1;
+
+		// id of the pointer (0, 1, 2, ..), npos if not valid.
+		uint64_t add(const JsonPointer& pointer);
+		uint64_t add(StringView pointer);
+		// route as in diff and patch, (string -> key, unsigned integer -> index)
+		//  overlap != nullptr -> not added if it is a strict prefix of another or the other way, then *overlap = true.
+		uint64_t add(const Array& route, bool* overlap = nullptr);
+
+		uint64_t size() const { return count; }
+
+		// result[id] : value or nullptr, pool = nullptr -> default_pool(). (used only for large batches)
+		void resolve(_Value& root, std_vector<_Value*>& result, std::shared_ptr<ThreadPool> pool = nullptr) const;
+		void resolve(const _Value& root, std_vector<const _Value*>& result, std::shared_ptr<ThreadPool> pool = nullptr) const;
+	private:
+		uint64_t insert(const std_vector<std::string>& keys, bool* overlap);
+		void children(const _Value& x, uint64_t node, std_vector<std::pair<const _Value*, uint64_t>>& out) const;
+		void walk(const _Value& x, uint64_t node, std_vector<const _Value*>& result) const;
+	};
+
+	// fields of objects in records into columns, slices of rows in parallel. pool = nullptr -> default_pool().
+	//  slot of each key is kept from the last record, so records with same layout need no find.
+	void extract_columns(const Array& records, std_vector<Column>& columns, std::shared_ptr<ThreadPool> pool = nullptr);
+
 	class parser {
 	private:
 		_simdjson::dom::parser_for_claujson test_;
-		std::unique_ptr<ThreadPool> pool;
+		std::shared_ptr<ThreadPool> pool;
+		std_vector<uint64_t> jump; // ParseOption::keep_jump
 	public:
+		// thr_num <= 0 -> default_pool(), else own pool.
 		parser(int thr_num = 0);
+		explicit parser(std::shared_ptr<ThreadPool> pool);
 	public:
 		// parse json file.
-		std::pair<bool, uint64_t> parse(const std::string& fileName, Document& d, uint64_t thr_num);
+		std::pair<bool, uint64_t> parse(const std::string& fileName, Document& d, uint64_t thr_num, const ParseOption& option = ParseOption());
 
 		//std::pair<bool, uint64_t> parse2(const std::string& fileName, Document2*& j, uint64_t thr_num);
 		
 		// parse json str.
-		std::pair<bool, uint64_t> parse_str(StringView str, Document& d, uint64_t thr_num);
+		std::pair<bool, uint64_t> parse_str(StringView str, Document& d, uint64_t thr_num, const ParseOption& option = ParseOption());
+
+		// only paths in `projection`, containers on the paths are kept even if nothing matches in them.
+		//  arrays keep only selected elements in order, so indices change. (ex) "/other/1" on {"other":[1,2,3]} -> {"other":[2]},
+		//  then "/other/1" does not resolve on the result. whole input is still validated. (ParseOption::keep_source is not used)
+		std::pair<bool, uint64_t> parse(const std::string& fileName, Document& d, const Projection& projection, uint64_t thr_num, const ParseOption& option = ParseOption());
+		std::pair<bool, uint64_t> parse_str(StringView str, Document& d, const Projection& projection, uint64_t thr_num, const ParseOption& option = ParseOption());
+
+		// root is array, on_element(i, x) gets each element in order as soon as it is built, no Document.
+		//  x is cleaned after on_element returns (std::move it to keep), on_element returns false -> stop.
+		//  second is number of elements given. (ParseOption::keep_source is not used)
+		//  on_element is called from one thread at a time, but not always from the calling thread. (maybe from a thread of the pool)
+		std::pair<bool, uint64_t> parse_array(const std::string& fileName, const std::function<bool(uint64_t, _Value&)>& on_element, uint64_t thr_num, const ParseOption& option = ParseOption());
+		std::pair<bool, uint64_t> parse_array_str(StringView str, const std::function<bool(uint64_t, _Value&)>& on_element, uint64_t thr_num, const ParseOption& option = ParseOption());
+
+		// events to handlers without making a tree, handlers[i] (made by make()) gets chunk i, chunks run in parallel.
+		//  values given to handlers are valid only in the call. caller merges results of handlers.
+		std::pair<bool, uint64_t> parse_sax(const std::string& fileName, const std::function<std::unique_ptr<SaxHandler>()>& make, std_vector<std::unique_ptr<SaxHandler>>& handlers, uint64_t thr_num);
+		std::pair<bool, uint64_t> parse_sax_str(StringView str, const std::function<std::unique_ptr<SaxHandler>()>& make, std_vector<std::unique_ptr<SaxHandler>>& handlers, uint64_t thr_num);
+
+		// validate and index tokens without making a tree, then cursor().
+		std::pair<bool, uint64_t> parse_cursor(const std::string& fileName, uint64_t thr_num);
+		std::pair<bool, uint64_t> parse_cursor_str(StringView str, uint64_t thr_num);
+		// at first token of the last parse_cursor, (at_end() if there is none)
+		Cursor cursor();
 
 #if __cpp_lib_char8_t
 		// C++20~
-		std::pair<bool, uint64_t> parse_str(std::u8string_view str, Document& d, uint64_t thr_num);
+		std::pair<bool, uint64_t> parse_str(std::u8string_view str, Document& d, uint64_t thr_num, const ParseOption& option = ParseOption());
 #endif
+
+		// minify or prettify json file without making a tree. on fail, sink can have a part of output.
+		//  layout is same as writer, but strings and numbers are copied as written. (ex) 1e10, "\u00e9", "\/" are not changed.
+		std::pair<bool, uint64_t> reformat(const std::string& fileName, Sink& sink, uint64_t thr_num, bool pretty = false);
+		std::pair<bool, uint64_t> reformat(const std::string& fileName, Sink& sink, uint64_t thr_num, const PrettyOption& option);
+
+		// minify or prettify json str without making a tree.
+		std::pair<bool, uint64_t> reformat_str(StringView str, Sink& sink, uint64_t thr_num, bool pretty = false);
+		std::pair<bool, uint64_t> reformat_str(StringView str, Sink& sink, uint64_t thr_num, const PrettyOption& option);
+
+		// tokens of the last parse with ParseOption::keep_jump, (else token_count() == 0) valid until next parse or reformat.
+		//  token is `[`, `]`, `{`, `}`, `:`, `,` or first char of string, number, true, false, null.
+		uint64_t token_count() const;
+		char token(uint64_t i) const;
+		uint64_t token_offset(uint64_t i) const; // in the input.
+		// token idx of matching `]` or `}`, `i` is `[` or `{`.
+		uint64_t match(uint64_t i) const;
+		// token after the value (or key : value) at `i`, O(1).
+		uint64_t skip(uint64_t i) const;
+	private:
+		bool stage1(const std::string& fileName);
+		bool stage1_str(StringView str);
+
+		std::pair<bool, uint64_t> _project(Document& d, const Projection& projection, uint64_t thr_num, const ParseOption& option);
+		std::pair<bool, uint64_t> _parse_array(const std::function<bool(uint64_t, _Value&)>& on_element, uint64_t thr_num, const ParseOption& option);
+		std::pair<bool, uint64_t> _parse_cursor(uint64_t thr_num);
+		std::pair<bool, uint64_t> _parse_sax(const std::function<std::unique_ptr<SaxHandler>()>& make, std_vector<std::unique_ptr<SaxHandler>>& handlers, uint64_t thr_num);
+
+		// option == nullptr -> minified.
+		std::pair<bool, uint64_t> _reformat(Sink& sink, uint64_t thr_num, const PrettyOption* option);
+	};
+
+	// output of writer, writer writes in place into buffers given by sink.
+	class Sink {
+	public:
+		virtual ~Sink() { }
+	public:
+		// writable buffer, at least `min_size`(<= 64) bytes, `*size` is available size. nullptr -> fail.
+		virtual char* next(uint64_t min_size, uint64_t* size) = 0;
+		// `used` bytes of the last buffer are written.
+		virtual bool commit(uint64_t used) = 0;
+		// end of writing.
+		virtual bool flush() { return true; }
+	};
+
+	// fixed buffer(size >= 64), when it is full, on_overflow(buf, used) is called and then the buffer is reused from start.
+	//  on_overflow returns false -> stop writing. after writing, rest is in data()[0, size()).
+	class FixedBufferSink : public Sink {
+	private:
+		char* buf;
+		uint64_t cap;
+		uint64_t used = 0;
+		std::function<bool(const char*, uint64_t)> on_overflow;
+	public:
+		FixedBufferSink(char* buf, uint64_t cap, std::function<bool(const char*, uint64_t)> on_overflow = nullptr)
+			: buf(buf), cap(cap), on_overflow(std::move(on_overflow)) {
+			//
+		}
+	public:
+		char* next(uint64_t min_size, uint64_t* size) override;
+		bool commit(uint64_t used) override;
+
+		const char* data() const { return buf; }
+		uint64_t size() const { return used; }
+		void clear() { used = 0; }
+	};
+
+	// appends to `out`, out can be reused (out.clear() keeps capacity).
+	class BufferSink : public Sink {
+	private:
+		std::string& out;
+		uint64_t used;
+	public:
+		explicit BufferSink(std::string& out) : out(out), used(out.size()) {
+			//
+		}
+	public:
+		char* next(uint64_t min_size, uint64_t* size) override;
+		bool commit(uint64_t used) override;
+		bool flush() override;
+	};
+
+	// file descriptor, not closed by sink.
+	class FdSink : public Sink {
+	private:
+		int fd;
+		std::unique_ptr<char[]> buf;
+		uint64_t cap;
+	public:
+		explicit FdSink(int fd, uint64_t buf_size = 1 << 16);
+	public:
+		char* next(uint64_t min_size, uint64_t* size) override;
+		bool commit(uint64_t used) override;
 	};
 
 	class writer {
 	private:
-		std::unique_ptr<ThreadPool> pool;
+		std::shared_ptr<ThreadPool> pool;
 	public:
+		// thr_num <= 0 -> default_pool(), else own pool.
 		writer(int thr_num = 0);
+		explicit writer(std::shared_ptr<ThreadPool> pool);
 	public:
 		std::string write_to_str(const _Value& global, bool prettty = false);
+		std::string write_to_str(const _Value& global, const PrettyOption& option);
 		std::string write_to_str2(const _Value& global, bool prettty = false);
 
 		void write(const std::string& fileName, const _Value& global, bool pretty = false);
+		void write(const std::string& fileName, const _Value& global, const PrettyOption& option);
+		
+		// returns false if sink fails.
+		bool write(Sink& sink, const _Value& global, bool pretty = false);
+		bool write(Sink& sink, const _Value& global, const PrettyOption& option);
 
+		// j without parents (ParseOption::keep_parent = false) is found at split points, then written as write_parallel2.
 		void write_parallel(const std::string& fileName, _Value& j, uint64_t thr_num, bool pretty = false);
+		void write_parallel(const std::string& fileName, _Value& j, uint64_t thr_num, const PrettyOption& option);
+		// uses Document::has_parent, no walk.
+		void write_parallel(const std::string& fileName, Document& d, uint64_t thr_num, bool pretty = false);
+		void write_parallel(const std::string& fileName, Document& d, uint64_t thr_num, const PrettyOption& option);
 		void write_parallel2(const std::string& fileName, const _Value& j, uint64_t thr_num, bool pretty = false);
+		void write_parallel2(const std::string& fileName, const _Value& j, uint64_t thr_num, const PrettyOption& option);
+		bool write_parallel2(Sink& sink, const _Value& j, uint64_t thr_num, bool pretty = false);
+		bool write_parallel2(Sink& sink, const _Value& j, uint64_t thr_num, const PrettyOption& option);
+
+		// not changed arrays and objects are copied from the input as is, (ParseOption::keep_source)
+		//  others are written like write(.., pretty = false).
+		bool write_incremental(Sink& sink, const Document& d);
+		void write_incremental(const std::string& fileName, const Document& d);
+		std::string write_incremental_to_str(const Document& d);
+	};
+
+	// current version of a Document for many readers, for live reload. readers do not block,
+	//  unless more than max_readers Readers are alive, then read() spins (and yields) until one is destroyed.
+	//  new version is parsed in a background thread and published with an atomic swap, (it is frozen, Document::freeze)
+	//  old version is destroyed in the background thread after all readers that could see it leave. (epoch based)
+	class DocumentHandle {
+	public:
+		// pins the version read, keep it short. (at most max_readers at once, read() of others spins)
+		class Reader {
+		private:
+			friend class DocumentHandle;
+			const DocumentHandle* handle = nullptr;
+			uint64_t slot = 0;
+			const Document* doc = nullptr;
+
+			Reader(const DocumentHandle* handle, uint64_t slot, const Document* doc) : handle(handle), slot(slot), doc(doc) { }
+		public:
+			Reader(Reader&& other) noexcept : handle(other.handle), slot(other.slot), doc(other.doc) { other.handle = nullptr; }
+			Reader(const Reader&) = delete;
+			Reader& operator=(const Reader&) = delete;
+			~Reader();
+
+			const Document& operator*() const { return *doc; }
+			const Document* operator->() const { return doc; }
+			const _Value& Get() const { return doc->Get(); }
+		};
+	private:
+		struct Slot {
+			std::atomic<uint64_t> epoch{ 0 }; // 0 : not used.
+			char pad[64 - sizeof(std::atomic<uint64_t>)];
+		};
+		struct Retired {
+			Document* doc;
+			uint64_t epoch; // can be read by readers pinned at epoch <= this.
+		};
+
+		std::atomic<Document*> current;
+		std::atomic<uint64_t> epoch{ 1 };
+		std::atomic<uint64_t> count{ 0 }; // version
+		std::atomic<uint64_t> pending_count{ 0 }; // published over, not destroyed yet.
+		const uint64_t slot_count;
+		std::unique_ptr<Slot[]> slots;
+
+		parser p;
+
+		// background thread, for reload jobs and reclamation.
+		std::mutex mutex;
+		std::condition_variable condition;
+		std_vector<std::function<void()>> jobs;
+		std_vector<Retired> retired;
+		bool stop = false;
+		std::thread worker;
+
+		void work();
+		bool reclaim(); // true if all retired are destroyed.
+	public:
+		// pool is for parsing, nullptr -> default_pool().
+		explicit DocumentHandle(Document&& d, std::shared_ptr<ThreadPool> pool = nullptr, uint64_t max_readers = 256);
+		// no Reader must be alive. waits reload jobs.
+		~DocumentHandle();
+
+		DocumentHandle(const DocumentHandle&) = delete;
+		DocumentHandle& operator=(const DocumentHandle&) = delete;
+
+		// spins if max_readers Readers are alive.
+		Reader read() const;
+
+		// freeze and swap, old one goes to background thread. returns new version.
+		uint64_t publish(Document&& d);
+
+		// parse in background thread, publish if ok. result of parse.
+		std::future<std::pair<bool, uint64_t>> reload(const std::string& fileName, uint64_t thr_num, const ParseOption& option = ParseOption());
+		std::future<std::pair<bool, uint64_t>> reload_str(std::string str, uint64_t thr_num, const ParseOption& option = ParseOption());
+
+		// number of publish calls.
+		uint64_t version() const { return count.load(std::memory_order_acquire); }
+		// number of old versions not destroyed yet, (waiting for their readers)
+		uint64_t pending() const { return pending_count.load(std::memory_order_acquire); }
 	};
 
 
@@ -136,6 +136,10 @@ namespace claujson {
 	}
 
 	void Array::clear(uint64_t idx) {
+		if (is_frozen()) {
+			return;
+		}
+		mark_dirty();
 		arr_vec[idx].clear(false);
 	}
 
@@ -143,7 +147,24 @@ namespace claujson {
 		bool _is_virtual = parent.left_type();
 		return _is_virtual;
 	}
+
+	bool Array::is_clean() const {
+		return parent.mid_type();
+	}
+
+	bool Array::is_frozen() const {
+		return parent.frozen_type();
+	}
+
+	void Array::mark_dirty() {
+		StructuredPtr(this).mark_dirty();
+	}
+
 	void Array::clear() {
+		if (is_frozen()) {
+			return;
+		}
+		mark_dirty();
 		arr_vec.clear();
 	}
 
@@ -170,7 +191,11 @@ namespace claujson {
 	}
 
 	bool Array::add_element(Value val) {
-		
+		if (is_frozen()) {
+			return false;
+		}
+		mark_dirty();
+
 		if (val.Get().is_array()) {
 			val.Get().as_array()->set_parent(this);
 		}
@@ -184,6 +209,11 @@ namespace claujson {
 	}
 
 	bool Array::assign_element(uint64_t idx, Value val) {
+		if (is_frozen()) {
+			return false;
+		}
+		mark_dirty();
+
 		if (val.Get().is_array()) {
 			val.Get().as_array()->set_parent(this);
 		}
@@ -223,6 +253,10 @@ namespace claujson {
 	}
 
 	void Array::erase(uint64_t idx, bool real) {
+		if (is_frozen()) {
+			return;
+		}
+		mark_dirty();
 
 		if (real) {
 			clean(arr_vec[idx]);
@@ -313,14 +347,14 @@ namespace claujson {
 	}
 
 	void Array::add_user_type(int64_t key_buf_idx, int64_t key_next_buf_idx, char* buf,
-		_ValueType type, uint64_t key_token_idx
+		_ValueType type, uint64_t key_token_idx, bool /*parent*/
 
 	) {
 		log << warn << "error";
 		ERROR("Array::add_user_type1");
 	}
 
-	void Array::add_user_type(_ValueType type
+	void Array::add_user_type(_ValueType type, bool parent
 
 	) {
 
@@ -335,7 +369,9 @@ namespace claujson {
 			}
 
 			arr_vec.push_back(_Value(json));
-			json->set_parent(this);
+			if (parent) {
+				json->set_parent(this);
+			}
 
 		}
 		else if (type == _ValueType::ARRAY) {
@@ -348,7 +384,9 @@ namespace claujson {
 			}
 
 			arr_vec.push_back(_Value(json));
-			json->set_parent(this);
+			if (parent) {
+				json->set_parent(this);
+			}
 		}
 	}
 	
@@ -21,6 +21,7 @@ namespace claujson {
 		friend class _Value;
 		friend class PartialJson;
 		friend class StructuredPtr;
+		friend class LoadData2;
 
 		Array* clone() const;
 
@@ -77,6 +78,13 @@ namespace claujson {
 
 		bool is_virtual() const;
 
+		// not changed after parsing, (ParseOption::keep_source)
+		bool is_clean() const;
+		// Document::freeze, then structural changes are ignored.
+		bool is_frozen() const;
+		// for changes through _Value& (ex. operator[]), marks also parents.
+		void mark_dirty();
+
 		void clear();
 
 		_ValueIterator begin();
@@ -107,13 +115,13 @@ namespace claujson {
 			char* buf, uint64_t val_token_idx);
 
 		void add_user_type(int64_t key_buf_idx, int64_t key_next_buf_idx, char* buf,
-			_ValueType type, uint64_t key_token_idx
+			_ValueType type, uint64_t key_token_idx, bool parent
 
 
 		);
 
 		//
-		void add_user_type(_ValueType type
+		void add_user_type(_ValueType type, bool parent
 
 		); // int type -> enum?
 
@@ -0,0 +1,883 @@
+﻿#include "claujson_jsonpath.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <limits>
+
+namespace claujson {
+
+	// recursive descent, fail -> JsonPath::ok is false.
+	class JsonPathCompiler {
+	private:
+		JsonPath& q;
+		const char* p;
+		const char* end;
+		bool fail = false;
+	public:
+		JsonPathCompiler(JsonPath& q, StringView str) : q(q), p(str.data()), end(str.data() + str.size()) { }
+
+		bool compile() {
+			ws();
+			if (!eat('$')) {
+				return false;
+			}
+			while (!fail) {
+				ws();
+				if (p >= end) {
+					break;
+				}
+				segment();
+			}
+			return !fail;
+		}
+	private:
+		void ws() {
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+				++p;
+			}
+		}
+		bool eat(char ch) {
+			if (p < end && *p == ch) {
+				++p;
+				return true;
+			}
+			return false;
+		}
+		bool eat(const char* str) {
+			const uint64_t len = strlen(str);
+			if ((uint64_t)(end - p) >= len && memcmp(p, str, len) == 0) {
+				p += len;
+				return true;
+			}
+			return false;
+		}
+		static bool name_first(char ch) {
+			return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_' || (uint8_t)ch >= 0x80;
+		}
+		static bool name_char(char ch) {
+			return name_first(ch) || (ch >= '0' && ch <= '9');
+		}
+
+		std::string name() {
+			const char* from = p;
+			if (p < end && name_first(*p)) {
+				++p;
+				while (p < end && name_char(*p)) {
+					++p;
+				}
+				return std::string(from, p);
+			}
+			fail = true;
+			return std::string();
+		}
+
+		void segment() {
+			JsonPath::Segment seg;
+			if (eat("..")) {
+				seg.descendant = true;
+				if (p < end && *p == '[') {
+					bracket(seg);
+				}
+				else if (eat('*')) {
+					seg.selectors.emplace_back();
+				}
+				else {
+					JsonPath::Selector s;
+					s.type = JsonPath::Selector::NAME;
+					s.name = name();
+					seg.selectors.push_back(std::move(s));
+				}
+			}
+			else if (eat('.')) {
+				if (eat('*')) {
+					seg.selectors.emplace_back();
+				}
+				else {
+					JsonPath::Selector s;
+					s.type = JsonPath::Selector::NAME;
+					s.name = name();
+					seg.selectors.push_back(std::move(s));
+				}
+			}
+			else if (p < end && *p == '[') {
+				bracket(seg);
+			}
+			else {
+				fail = true;
+			}
+			q.segments.push_back(std::move(seg));
+		}
+
+		void bracket(JsonPath::Segment& seg) {
+			eat('[');
+			do {
+				ws();
+				seg.selectors.push_back(selector());
+				ws();
+			} while (!fail && eat(','));
+			if (!eat(']')) {
+				fail = true;
+			}
+		}
+
+		JsonPath::Selector selector() {
+			JsonPath::Selector s;
+			if (p >= end) {
+				fail = true;
+			}
+			else if (*p == '\'' || *p == '"') {
+				s.type = JsonPath::Selector::NAME;
+				s.name = string();
+			}
+			else if (eat('*')) {
+				s.type = JsonPath::Selector::WILDCARD;
+			}
+			else if (eat('?')) {
+				s.type = JsonPath::Selector::FILTER;
+				ws();
+				s.filter = logical_or();
+			}
+			else { // index or slice
+				if (*p != ':') {
+					s.index = integer();
+					s.start = s.index;
+					s.has_start = true;
+					ws();
+				}
+				if (eat(':')) {
+					s.type = JsonPath::Selector::SLICE;
+					ws();
+					if (p < end && (*p == '-' || (*p >= '0' && *p <= '9'))) {
+						s.end = integer();
+						s.has_end = true;
+						ws();
+					}
+					if (eat(':')) {
+						ws();
+						if (p < end && (*p == '-' || (*p >= '0' && *p <= '9'))) {
+							s.step = integer();
+						}
+					}
+				}
+				else {
+					s.type = JsonPath::Selector::INDEX;
+				}
+			}
+			return s;
+		}
+
+		int64_t integer() {
+			const char* from = p;
+			eat('-');
+			const char* digits = p;
+			while (p < end && *p >= '0' && *p <= '9') {
+				++p;
+			}
+			// no leading zeros and no "-0", (RFC 9535)
+			if (p == digits || p - from > 19 || (*digits == '0' && p - from > 1)) {
+				fail = true;
+				return 0;
+			}
+			return std::strtoll(std::string(from, p).c_str(), nullptr, 10);
+		}
+
+		static void utf8(std::string& out, uint32_t cp) {
+			if (cp < 0x80) {
+				out.push_back((char)cp);
+			}
+			else if (cp < 0x800) {
+				out.push_back((char)(0xC0 | (cp >> 6)));
+				out.push_back((char)(0x80 | (cp & 0x3F)));
+			}
+			else if (cp < 0x10000) {
+				out.push_back((char)(0xE0 | (cp >> 12)));
+				out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+				out.push_back((char)(0x80 | (cp & 0x3F)));
+			}
+			else {
+				out.push_back((char)(0xF0 | (cp >> 18)));
+				out.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+				out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+				out.push_back((char)(0x80 | (cp & 0x3F)));
+			}
+		}
+
+		uint32_t hex4() {
+			uint32_t x = 0;
+			for (int i = 0; i < 4; ++i) {
+				if (p >= end) {
+					fail = true;
+					return 0;
+				}
+				const char ch = *p++;
+				x <<= 4;
+				if (ch >= '0' && ch <= '9') { x |= ch - '0'; }
+				else if (ch >= 'a' && ch <= 'f') { x |= ch - 'a' + 10; }
+				else if (ch >= 'A' && ch <= 'F') { x |= ch - 'A' + 10; }
+				else { fail = true; return 0; }
+			}
+			return x;
+		}
+
+		// '..' or "..", with escapes.
+		std::string string() {
+			std::string out;
+			const char quote = *p++;
+			while (!fail) {
+				if (p >= end) {
+					fail = true;
+					break;
+				}
+				const char ch = *p++;
+				if (ch == quote) {
+					break;
+				}
+				if (ch != '\\') {
+					out.push_back(ch);
+					continue;
+				}
+				if (p >= end) {
+					fail = true;
+					break;
+				}
+				switch (*p++) {
+				case 'b': out.push_back('\b'); break;
+				case 'f': out.push_back('\f'); break;
+				case 'n': out.push_back('\n'); break;
+				case 'r': out.push_back('\r'); break;
+				case 't': out.push_back('\t'); break;
+				case '/': out.push_back('/'); break;
+				case '\\': out.push_back('\\'); break;
+				case '\'': out.push_back('\''); break;
+				case '"': out.push_back('"'); break;
+				case 'u':
+				{
+					uint32_t cp = hex4();
+					if (cp >= 0xD800 && cp < 0xDC00 && eat("\\u")) {
+						const uint32_t low = hex4();
+						cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+					}
+					utf8(out, cp);
+				}
+				break;
+				default:
+					fail = true;
+				}
+			}
+			return out;
+		}
+
+		uint64_t add(JsonPath::Expr&& e) {
+			q.exprs.push_back(std::move(e));
+			return q.exprs.size() - 1;
+		}
+
+		uint64_t logical_or() {
+			uint64_t a = logical_and();
+			ws();
+			while (!fail && eat("||")) {
+				JsonPath::Expr e;
+				e.op = JsonPath::Expr::OR;
+				e.a = a;
+				e.b = logical_and();
+				a = add(std::move(e));
+				ws();
+			}
+			return a;
+		}
+
+		uint64_t logical_and() {
+			uint64_t a = basic();
+			ws();
+			while (!fail && eat("&&")) {
+				JsonPath::Expr e;
+				e.op = JsonPath::Expr::AND;
+				e.a = a;
+				e.b = basic();
+				a = add(std::move(e));
+				ws();
+			}
+			return a;
+		}
+
+		uint64_t basic() {
+			ws();
+			if (eat('!')) {
+				JsonPath::Expr e;
+				e.op = JsonPath::Expr::NOT;
+				e.a = basic();
+				return add(std::move(e));
+			}
+			if (eat('(')) {
+				const uint64_t a = logical_or();
+				ws();
+				if (!eat(')')) {
+					fail = true;
+				}
+				return a;
+			}
+
+			JsonPath::Expr e;
+			e.left = operand();
+			ws();
+			if (eat("==")) { e.cmp = JsonPath::Expr::EQ; }
+			else if (eat("!=")) { e.cmp = JsonPath::Expr::NE; }
+			else if (eat("<=")) { e.cmp = JsonPath::Expr::LE; }
+			else if (eat(">=")) { e.cmp = JsonPath::Expr::GE; }
+			else if (eat('<')) { e.cmp = JsonPath::Expr::LT; }
+			else if (eat('>')) { e.cmp = JsonPath::Expr::GT; }
+			else { // existence test.
+				if (e.left.kind == JsonPath::Operand::LITERAL) {
+					fail = true;
+				}
+				e.op = JsonPath::Expr::EXIST;
+				return add(std::move(e));
+			}
+			ws();
+			e.op = JsonPath::Expr::CMP;
+			e.right = operand();
+			return add(std::move(e));
+		}
+
+		JsonPath::Operand operand() {
+			JsonPath::Operand o;
+			if (p >= end) {
+				fail = true;
+				return o;
+			}
+			if (*p == '@' || *p == '$') {
+				o.kind = *p == '@' ? JsonPath::Operand::CURRENT : JsonPath::Operand::ROOT;
+				++p;
+				while (!fail && p < end) { // singular path.
+					JsonPath::Step step;
+					if (p + 1 < end && p[0] == '.' && p[1] != '.' && p[1] != '*') {
+						++p;
+						step.name = name();
+					}
+					else if (*p == '[') {
+						++p;
+						ws();
+						if (p < end && (*p == '\'' || *p == '"')) {
+							step.name = string();
+						}
+						else {
+							step.index = integer();
+							step.is_index = true;
+						}
+						ws();
+						if (!eat(']')) {
+							fail = true;
+						}
+					}
+					else if (*p == '.') {
+						fail = true; // `..` or `.*`, not singular.
+					}
+					else {
+						break;
+					}
+					o.path.push_back(std::move(step));
+				}
+				return o;
+			}
+
+			o.kind = JsonPath::Operand::LITERAL;
+			if (*p == '\'' || *p == '"') {
+				o.type = 's';
+				o.str = string();
+			}
+			else if (eat("true")) {
+				o.type = 't';
+			}
+			else if (eat("false")) {
+				o.type = 'f';
+			}
+			else if (eat("null")) {
+				o.type = 'z';
+			}
+			else if (*p == '-' || (*p >= '0' && *p <= '9')) {
+				const char* from = p;
+				bool integral = true;
+				eat('-');
+				if (p + 1 < end && *p == '0' && p[1] >= '0' && p[1] <= '9') { // no leading zeros, (RFC 9535)
+					fail = true;
+				}
+				while (p < end && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' || *p == '+' || *p == '-')) {
+					integral = integral && *p >= '0' && *p <= '9';
+					++p;
+				}
+				const std::string text(from, p);
+				char* last = nullptr;
+				o.type = 'n';
+				o.num = std::strtod(text.c_str(), &last);
+				if (last != text.c_str() + text.size()) {
+					fail = true;
+				}
+				if (integral && text.size() <= 18) {
+					o.is_integer = true;
+					o.integer = std::strtoll(text.c_str(), nullptr, 10);
+				}
+			}
+			else {
+				fail = true;
+			}
+			return o;
+		}
+	};
+
+	// evaluates segments, large steps are split into units and run on the pool.
+	class JsonPathRunner {
+	private:
+		typedef JsonPath::Selector Selector;
+		typedef JsonPath::Segment Segment;
+		typedef JsonPath::Operand Operand;
+		typedef JsonPath::Expr Expr;
+
+		// INPUTS : selectors on in[begin, end), CHILDREN : one selector on children [begin, end) of x,
+		//  DESC_INPUTS : in[begin, end) and their descendants, SELF : selectors on x, SUBTREES : children [begin, end) of x and their descendants.
+		struct Unit {
+			enum Kind { INPUTS, CHILDREN, DESC_INPUTS, SELF, SUBTREES };
+			Kind kind;
+			const _Value* x;
+			uint64_t begin, end;
+		};
+
+		// scalar view of value or literal, no allocation.
+		struct Scalar {
+			enum Kind { NOTHING, NUMBER, STRING, BOOLEAN, NUL, STRUCTURED };
+			Kind kind = NOTHING;
+			double num = 0;
+			int64_t integer = 0;
+			bool is_integer = false;
+			bool boolean = false;
+			const char* str = nullptr;
+			uint64_t len = 0;
+			const _Value* node = nullptr;
+		};
+
+		static const uint64_t grain = 1024; // children or inputs per unit.
+
+		const JsonPath& q;
+		const _Value& root;
+		std::shared_ptr<ThreadPool> pool;
+	public:
+		JsonPathRunner(const JsonPath& q, const _Value& root, std::shared_ptr<ThreadPool> pool) : q(q), root(root), pool(std::move(pool)) { }
+
+		// all segments but `last` from root.
+		void run(uint64_t last, std_vector<const _Value*>& out) {
+			out.clear();
+			out.push_back(&root);
+			std_vector<const _Value*> next;
+			for (uint64_t i = 0; i < last; ++i) {
+				step(q.segments[i], out, next);
+				out.swap(next);
+			}
+		}
+
+		void step(const Segment& seg, const std_vector<const _Value*>& in, std_vector<const _Value*>& out) {
+			std_vector<Unit> us;
+			out.clear();
+			if (!units(seg, in, us)) {
+				for (auto& u : us) {
+					run_unit(seg, in, u, out);
+				}
+				return;
+			}
+			std_vector<std_vector<const _Value*>> part(us.size());
+			get_pool()->parallel_for(0, us.size(), 1, [&](uint64_t i) {
+				run_unit(seg, in, us[i], part[i]);
+			});
+			for (auto& x : part) {
+				out.insert(out.end(), x.begin(), x.end());
+			}
+		}
+
+		// last segment, results to f in windows of units.
+		uint64_t stream(const Segment& seg, const std_vector<const _Value*>& in, const std::function<bool(const _Value&)>& f) {
+			std_vector<Unit> us;
+			uint64_t count = 0;
+			const bool parallel = units(seg, in, us);
+			const uint64_t window = parallel ? (get_pool()->size() + 1) * 4 : 1;
+			std_vector<std_vector<const _Value*>> part(std::min<uint64_t>(window, us.size()));
+
+			for (uint64_t i = 0; i < us.size(); i += window) {
+				const uint64_t n = std::min<uint64_t>(window, us.size() - i);
+				for (uint64_t k = 0; k < n; ++k) {
+					part[k].clear();
+				}
+				if (n > 1) {
+					get_pool()->parallel_for(0, n, 1, [&](uint64_t k) {
+						run_unit(seg, in, us[i + k], part[k]);
+					});
+				}
+				else {
+					run_unit(seg, in, us[i], part[0]);
+				}
+				for (uint64_t k = 0; k < n; ++k) {
+					for (auto* x : part[k]) {
+						++count;
+						if (!f(*x)) {
+							return count;
+						}
+					}
+				}
+			}
+			return count;
+		}
+	private:
+		ThreadPool* get_pool() {
+			if (!pool) {
+				pool = default_pool();
+			}
+			return pool.get();
+		}
+
+		static uint64_t size_of(const _Value& x) {
+			return x.is_array() ? x.as_array()->get_data_size() : x.is_object() ? x.as_object()->get_data_size() : 0;
+		}
+		static const _Value& child_of(const _Value& x, uint64_t i) {
+			return x.is_array() ? x.as_array()->get_value_list(i) : x.as_object()->get_value_list(i);
+		}
+		static const _Value* find(const _Value& x, const std::string& name) {
+			if (!x.is_object()) {
+				return nullptr;
+			}
+			const Object* obj = x.as_object();
+			const uint64_t n = obj->get_data_size();
+			for (uint64_t i = 0; i < n; ++i) {
+				const _Value& key = obj->get_key_list(i);
+				if (key.get_string().size() == name.size() && memcmp(key.get_string().data(), name.data(), name.size()) == 0) {
+					return &obj->get_value_list(i);
+				}
+			}
+			return nullptr;
+		}
+		static const _Value* at(const _Value& x, int64_t index) {
+			if (!x.is_array()) {
+				return nullptr;
+			}
+			const int64_t n = x.as_array()->get_data_size();
+			if (index < 0) {
+				index += n;
+			}
+			if (index < 0 || index >= n) {
+				return nullptr;
+			}
+			return &x.as_array()->get_value_list(index);
+		}
+
+		// false -> run units in order in this thread.
+		bool units(const Segment& seg, const std_vector<const _Value*>& in, std_vector<Unit>& us) {
+			const bool by_children = !seg.descendant && seg.selectors.size() == 1 &&
+				(seg.selectors[0].type == Selector::WILDCARD || seg.selectors[0].type == Selector::FILTER);
+			const Unit::Kind inputs = seg.descendant ? Unit::DESC_INPUTS : Unit::INPUTS;
+			uint64_t work = 0;
+			uint64_t from = 0, acc = 0; // group of small inputs.
+
+			for (uint64_t i = 0; i < in.size(); ++i) {
+				const uint64_t n = size_of(*in[i]);
+				work += n + 1;
+				if ((by_children || seg.descendant) && n > grain) {
+					if (from < i) {
+						us.push_back({ inputs, nullptr, from, i });
+					}
+					if (seg.descendant) {
+						us.push_back({ Unit::SELF, in[i], 0, 0 });
+						const uint64_t g = std::max<uint64_t>(1, n / ((pool ? pool->size() : 1) * 8 + 8));
+						for (uint64_t k = 0; k < n; k += g) {
+							us.push_back({ Unit::SUBTREES, in[i], k, std::min(n, k + g) });
+						}
+					}
+					else {
+						for (uint64_t k = 0; k < n; k += grain) {
+							us.push_back({ Unit::CHILDREN, in[i], k, std::min(n, k + grain) });
+						}
+					}
+					from = i + 1;
+					acc = 0;
+					continue;
+				}
+				acc += n + 1;
+				if (acc >= grain) {
+					us.push_back({ inputs, nullptr, from, i + 1 });
+					from = i + 1;
+					acc = 0;
+				}
+			}
+			if (from < in.size()) {
+				us.push_back({ inputs, nullptr, from, in.size() });
+			}
+			return us.size() > 1 && (work >= 2 * grain || seg.descendant);
+		}
+
+		void run_unit(const Segment& seg, const std_vector<const _Value*>& in, const Unit& u, std_vector<const _Value*>& out) {
+			switch (u.kind) {
+			case Unit::INPUTS:
+				for (uint64_t i = u.begin; i < u.end; ++i) {
+					for (auto& s : seg.selectors) {
+						select(s, *in[i], 0, size_of(*in[i]), out);
+					}
+				}
+				break;
+			case Unit::CHILDREN:
+				select(seg.selectors[0], *u.x, u.begin, u.end, out);
+				break;
+			case Unit::DESC_INPUTS:
+				for (uint64_t i = u.begin; i < u.end; ++i) {
+					descend(seg, *in[i], out);
+				}
+				break;
+			case Unit::SELF:
+				for (auto& s : seg.selectors) {
+					select(s, *u.x, 0, size_of(*u.x), out);
+				}
+				break;
+			case Unit::SUBTREES:
+				for (uint64_t i = u.begin; i < u.end; ++i) {
+					descend(seg, child_of(*u.x, i), out);
+				}
+				break;
+			}
+		}
+
+		// x and its descendants in document order, own stack. (deep documents)
+		void descend(const Segment& seg, const _Value& x, std_vector<const _Value*>& out) {
+			std_vector<std::pair<const _Value*, uint64_t>> stack;
+			for (auto& s : seg.selectors) {
+				select(s, x, 0, size_of(x), out);
+			}
+			stack.push_back({ &x, 0 });
+			while (!stack.empty()) {
+				auto& top = stack.back();
+				if (top.second >= size_of(*top.first)) {
+					stack.pop_back();
+					continue;
+				}
+				const _Value& y = child_of(*top.first, top.second++);
+				if (y.is_structured()) {
+					for (auto& s : seg.selectors) {
+						select(s, y, 0, size_of(y), out);
+					}
+					stack.push_back({ &y, 0 });
+				}
+			}
+		}
+
+		// [begin, end) : children, for WILDCARD and FILTER.
+		void select(const Selector& s, const _Value& x, uint64_t begin, uint64_t end, std_vector<const _Value*>& out) {
+			if (!x.is_structured()) {
+				return;
+			}
+			switch (s.type) {
+			case Selector::NAME:
+			{
+				const _Value* y = find(x, s.name);
+				if (y) {
+					out.push_back(y);
+				}
+			}
+			break;
+			case Selector::INDEX:
+			{
+				const _Value* y = at(x, s.index);
+				if (y) {
+					out.push_back(y);
+				}
+			}
+			break;
+			case Selector::SLICE:
+				slice(s, x, out);
+				break;
+			case Selector::WILDCARD:
+				for (uint64_t i = begin; i < end; ++i) {
+					out.push_back(&child_of(x, i));
+				}
+				break;
+			case Selector::FILTER:
+				for (uint64_t i = begin; i < end; ++i) {
+					const _Value& y = child_of(x, i);
+					if (eval(s.filter, y)) {
+						out.push_back(&y);
+					}
+				}
+				break;
+			}
+		}
+
+		static void slice(const Selector& s, const _Value& x, std_vector<const _Value*>& out) {
+			if (!x.is_array() || s.step == 0) {
+				return;
+			}
+			const Array* arr = x.as_array();
+			const int64_t n = arr->get_data_size();
+			auto norm = [n](int64_t i) { return i >= 0 ? i : n + i; };
+
+			if (s.step > 0) {
+				const int64_t lower = std::min(std::max<int64_t>(s.has_start ? norm(s.start) : 0, 0), n);
+				const int64_t upper = std::min(std::max<int64_t>(s.has_end ? norm(s.end) : n, 0), n);
+				for (int64_t i = lower; i < upper; i += s.step) {
+					out.push_back(&arr->get_value_list(i));
+				}
+			}
+			else {
+				const int64_t upper = std::min(std::max<int64_t>(s.has_start ? norm(s.start) : n - 1, -1), n - 1);
+				const int64_t lower = std::min(std::max<int64_t>(s.has_end ? norm(s.end) : -n - 1, -1), n - 1);
+				for (int64_t i = upper; lower < i; i += s.step) {
+					out.push_back(&arr->get_value_list(i));
+				}
+			}
+		}
+
+		const _Value* resolve(const Operand& o, const _Value& now) const {
+			const _Value* x = o.kind == Operand::ROOT ? &root : &now;
+			for (auto& step : o.path) {
+				x = step.is_index ? at(*x, step.index) : find(*x, step.name);
+				if (!x) {
+					return nullptr;
+				}
+			}
+			return x;
+		}
+
+		Scalar scalar(const Operand& o, const _Value& now) const {
+			Scalar r;
+			if (o.kind == Operand::LITERAL) {
+				switch (o.type) {
+				case 'n': r.kind = Scalar::NUMBER; r.num = o.num; r.integer = o.integer; r.is_integer = o.is_integer; break;
+				case 's': r.kind = Scalar::STRING; r.str = o.str.data(); r.len = o.str.size(); break;
+				case 't': r.kind = Scalar::BOOLEAN; r.boolean = true; break;
+				case 'f': r.kind = Scalar::BOOLEAN; break;
+				default: r.kind = Scalar::NUL; break;
+				}
+				return r;
+			}
+
+			const _Value* x = resolve(o, now);
+			if (!x) {
+				return r;
+			}
+			if (x->is_int()) {
+				r.kind = Scalar::NUMBER; r.integer = x->get_integer(); r.is_integer = true; r.num = (double)r.integer;
+			}
+			else if (x->is_uint()) {
+				r.kind = Scalar::NUMBER; r.num = (double)x->get_unsigned_integer();
+				r.is_integer = x->get_unsigned_integer() <= (uint64_t)std::numeric_limits<int64_t>::max();
+				r.integer = (int64_t)x->get_unsigned_integer();
+			}
+			else if (x->is_float()) {
+				r.kind = Scalar::NUMBER; r.num = x->get_floating();
+			}
+			else if (x->is_str()) {
+				r.kind = Scalar::STRING; r.str = x->get_string().data(); r.len = x->get_string().size();
+			}
+			else if (x->is_bool()) {
+				r.kind = Scalar::BOOLEAN; r.boolean = x->get_boolean();
+			}
+			else if (x->is_null()) {
+				r.kind = Scalar::NUL;
+			}
+			else {
+				r.kind = Scalar::STRUCTURED; r.node = x;
+			}
+			return r;
+		}
+
+		static bool equal(const Scalar& a, const Scalar& b) {
+			if (a.kind != b.kind) {
+				return false;
+			}
+			switch (a.kind) {
+			case Scalar::NUMBER:
+				return a.is_integer && b.is_integer ? a.integer == b.integer : a.num == b.num;
+			case Scalar::STRING:
+				return a.len == b.len && memcmp(a.str, b.str, a.len) == 0;
+			case Scalar::BOOLEAN:
+				return a.boolean == b.boolean;
+			case Scalar::STRUCTURED:
+				return a.node == b.node;
+			default:
+				return true;
+			}
+		}
+
+		static bool less(const Scalar& a, const Scalar& b) {
+			if (a.kind == Scalar::NUMBER && b.kind == Scalar::NUMBER) {
+				return a.is_integer && b.is_integer ? a.integer < b.integer : a.num < b.num;
+			}
+			if (a.kind == Scalar::STRING && b.kind == Scalar::STRING) {
+				const int c = memcmp(a.str, b.str, std::min(a.len, b.len));
+				return c < 0 || (c == 0 && a.len < b.len);
+			}
+			return false;
+		}
+
+		bool eval(uint64_t i, const _Value& now) const {
+			const Expr& e = q.exprs[i];
+			switch (e.op) {
+			case Expr::OR:
+				return eval(e.a, now) || eval(e.b, now);
+			case Expr::AND:
+				return eval(e.a, now) && eval(e.b, now);
+			case Expr::NOT:
+				return !eval(e.a, now);
+			case Expr::EXIST:
+				return resolve(e.left, now) != nullptr;
+			case Expr::CMP:
+			{
+				const Scalar a = scalar(e.left, now);
+				const Scalar b = scalar(e.right, now);
+				switch (e.cmp) {
+				case Expr::EQ: return equal(a, b);
+				case Expr::NE: return !equal(a, b);
+				case Expr::LT: return less(a, b);
+				case Expr::LE: return less(a, b) || equal(a, b);
+				case Expr::GT: return less(b, a);
+				case Expr::GE: return less(b, a) || equal(a, b);
+				}
+			}
+			}
+			return false;
+		}
+	};
+
+	JsonPath::JsonPath(StringView query) {
+		JsonPathCompiler compiler(*this, query);
+		ok = compiler.compile();
+		if (!ok) {
+			segments.clear();
+			exprs.clear();
+		}
+	}
+
+	std_vector<const _Value*> JsonPath::query(const _Value& root, std::shared_ptr<ThreadPool> pool) const {
+		std_vector<const _Value*> result;
+		if (!ok) {
+			return result;
+		}
+		JsonPathRunner runner(*this, root, std::move(pool));
+		runner.run(segments.size(), result);
+		return result;
+	}
+
+	std_vector<_Value*> JsonPath::query(_Value& root, std::shared_ptr<ThreadPool> pool) const {
+		std_vector<const _Value*> temp = query(static_cast<const _Value&>(root), std::move(pool));
+		std_vector<_Value*> result(temp.size());
+		for (uint64_t i = 0; i < temp.size(); ++i) {
+			result[i] = const_cast<_Value*>(temp[i]);
+		}
+		return result;
+	}
+
+	uint64_t JsonPath::for_each(const _Value& root, const std::function<bool(const _Value&)>& f, std::shared_ptr<ThreadPool> pool) const {
+		if (!ok) {
+			return 0;
+		}
+		JsonPathRunner runner(*this, root, std::move(pool));
+		if (segments.empty()) {
+			f(root);
+			return 1;
+		}
+		std_vector<const _Value*> in;
+		runner.run(segments.size() - 1, in);
+		return runner.stream(segments.back(), in, f);
+	}
+}
@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#include "claujson.h"
+
+namespace claujson {
+	class JsonPathCompiler;
+	class JsonPathRunner;
+
+	// JSONPath (RFC 9535) query over the tree, compiled once.
+	//  $, .name, .*, ..name, ..*, ['name'], [n] (n < 0 : from end), [start:end:step], [*], [a, 'b', ..],
+	//  filters [?@.a > 1 && (@.b == 'x' || !@.c)], [?(@.a)] with singular paths (from @ or $, names and indices)
+	//  and literals (number, string, true, false, null). functions (length(), match(), ..) are not supported.
+	class JsonPath {
+	public:
+		friend class JsonPathCompiler;
+		friend class JsonPathRunner;
+	private:
+		struct Step {
+			std::string name;
+			int64_t index = 0;
+			bool is_index = false;
+		};
+		// of filter, path from @ or $, or literal.
+		struct Operand {
+			enum Kind { CURRENT, ROOT, LITERAL };
+			Kind kind = LITERAL;
+			std_vector<Step> path;
+			char type = 'z'; // literal, 'n' : number, 's' : string, 't', 'f', 'z' : null
+			double num = 0;
+			int64_t integer = 0;
+			bool is_integer = false;
+			std::string str;
+		};
+		struct Expr {
+			enum Op { OR, AND, NOT, EXIST, CMP };
+			enum Cmp { EQ, NE, LT, LE, GT, GE };
+			Op op = EXIST;
+			uint64_t a = 0, b = 0; // sub expressions.
+			Operand left, right;
+			Cmp cmp = EQ;
+		};
+		struct Selector {
+			enum Type { NAME, INDEX, SLICE, WILDCARD, FILTER };
+			Type type = WILDCARD;
+			std::string name;
+			int64_t index = 0;
+			int64_t start = 0, end = 0, step = 1;
+			bool has_start = false, has_end = false;
+			uint64_t filter = 0; // idx of Expr
+		};
+		struct Segment {
+			bool descendant = false;
+			std_vector<Selector> selectors;
+		};
+
+		std_vector<Segment> segments;
+		std_vector<Expr> exprs;
+		bool ok = false;
+	public:
+		JsonPath() { }
+		explicit JsonPath(StringView query); // valid() is false if query is not valid or not supported.
+
+		bool valid() const { return ok; }
+
+		// results in document order, pool = nullptr -> default_pool(). (used only for large steps)
+		std_vector<const _Value*> query(const _Value& root, std::shared_ptr<ThreadPool> pool = nullptr) const;
+		std_vector<_Value*> query(_Value& root, std::shared_ptr<ThreadPool> pool = nullptr) const;
+
+		// f(x) in document order as results of last step are found, f returns false -> stop. returns number of calls.
+		uint64_t for_each(const _Value& root, const std::function<bool(const _Value&)>& f, std::shared_ptr<ThreadPool> pool = nullptr) const;
+	};
+}
@@ -6,6 +6,12 @@ namespace claujson {
 	_Value Object::data_null{ nullptr, false }; // valid is false..
 	const uint64_t Object::npos = -1; // 
 
+	// open addressing, slot : idx + 1, 0 : empty. same keys are in order of idx.
+	struct Object::KeyIndex {
+		uint64_t mask = 0;
+		std::unique_ptr<uint32_t[]> slot;
+	};
+
 	class CompKey {
 	private:
 		const std_vector<Pair<_Value, _Value>>* vec;
@@ -86,6 +92,8 @@ namespace claujson {
 	Object::Object() {}
 
 	Object::~Object() {
+		delete index.load(std::memory_order_relaxed);
+
 		for (auto& x : obj_data) {
 			if (x.second.is_array()) {
 				delete x.second.as_array();
@@ -130,6 +138,10 @@ namespace claujson {
 	}
 
 	void Object::clear(uint64_t idx) {
+		if (is_frozen()) {
+			return;
+		}
+		mark_dirty();
 		obj_data[idx].second.clear(false);
 		obj_data[idx].first.clear(false);
 	}
@@ -139,7 +151,29 @@ namespace claujson {
 		return _is_virtual;
 	}
 
+	bool Object::is_clean() const {
+		return parent.mid_type();
+	}
+
+	bool Object::is_frozen() const {
+		return parent.frozen_type();
+	}
+
+	void Object::mark_dirty() {
+		if (is_frozen()) { // readers can use the index.
+			return;
+		}
+		StructuredPtr(this).mark_dirty();
+
+		// not frozen, so no reader.
+		delete index.exchange(nullptr, std::memory_order_relaxed);
+	}
+
 	void Object::clear() {
+		if (is_frozen()) {
+			return;
+		}
+		mark_dirty();
 		obj_data.clear();
 	}
 
@@ -176,6 +210,10 @@ namespace claujson {
 			return npos;
 		}
 
+		if (key_index()) {
+			return find(StringView(key.get_string().data(), key.get_string().size()));
+		}
+
 		uint64_t len = get_data_size();
 		for (uint64_t i = 0; i < len; ++i) {
 			if (get_key_list(i) == key) {
@@ -186,6 +224,81 @@ namespace claujson {
 		return -1;
 	}
 
+	const Object::KeyIndex* Object::key_index() const {
+		const uint64_t len = get_data_size();
+		if (len < 16 || len >= 0xFFFFFFFF || !is_frozen()) {
+			return nullptr;
+		}
+
+		KeyIndex* x = index.load(std::memory_order_acquire);
+		if (x) {
+			return x;
+		}
+
+		// build, other threads maybe also build, first one is used.
+		uint64_t cap = 32;
+		while (cap < len * 2) {
+			cap = cap * 2;
+		}
+		KeyIndex* temp = new (std::nothrow) KeyIndex();
+		if (!temp) {
+			return nullptr;
+		}
+		temp->slot.reset(new (std::nothrow) uint32_t[cap]());
+		if (!temp->slot) {
+			delete temp;
+			return nullptr;
+		}
+		temp->mask = cap - 1;
+		for (uint64_t i = 0; i < len; ++i) {
+			const String& key = obj_data[i].first.get_string();
+			uint64_t j = key_hash(key.data(), key.size()) & temp->mask;
+			while (temp->slot[j]) {
+				j = (j + 1) & temp->mask;
+			}
+			temp->slot[j] = (uint32_t)(i + 1);
+		}
+
+		if (index.compare_exchange_strong(x, temp, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			return temp;
+		}
+		delete temp;
+		return x;
+	}
+
+	uint64_t Object::find(StringView key, uint64_t hash) const {
+		const KeyIndex* x = key_index();
+		if (!x) {
+			return find(key);
+		}
+		for (uint64_t j = hash & x->mask; x->slot[j]; j = (j + 1) & x->mask) {
+			const String& str = obj_data[x->slot[j] - 1].first.get_string();
+			if (str.size() == key.size() && memcmp(str.data(), key.data(), key.size()) == 0) {
+				return x->slot[j] - 1;
+			}
+		}
+		return npos;
+	}
+
+	uint64_t Object::find(StringView key) const {
+		if (key_index()) {
+			return find(key, key_hash(key.data(), key.size()));
+		}
+
+		const uint64_t len = get_data_size();
+		for (uint64_t i = 0; i < len; ++i) {
+			const String& x = obj_data[i].first.get_string();
+			if (x.size() == key.size() && memcmp(x.data(), key.data(), key.size()) == 0) {
+				return i;
+			}
+		}
+		return npos;
+	}
+
+	uint64_t Object::find(const Key& key) const {
+		return find(key.view(), key.hash());
+	}
+
 	_Value& Object::operator[](uint64_t idx) {
 		if (idx >= get_data_size()) {
 			return data_null;
@@ -217,6 +330,28 @@ namespace claujson {
 		return get_value_list(idx);
 	}
 
+	_Value& Object::operator[](StringView key) {
+		uint64_t idx = find(key);
+		if (idx == npos) {
+			return data_null;
+		}
+		return get_value_list(idx);
+	}
+	const _Value& Object::operator[](StringView key) const {
+		uint64_t idx = find(key);
+		if (idx == npos) {
+			return data_null;
+		}
+		return get_value_list(idx);
+	}
+
+	_Value& Object::operator[](const Key& key) {
+		return (*this)[key.view()];
+	}
+	const _Value& Object::operator[](const Key& key) const {
+		return (*this)[key.view()];
+	}
+
 
 
 	void Object::null_parent() {
@@ -240,12 +375,13 @@ namespace claujson {
 	}
 
 	bool Object::change_key(const _Value& key, Value new_key) { // chk test...
-		if (this->is_object() && key.is_str() && new_key.Get().is_str()) {
+		if (this->is_object() && !is_frozen() && key.is_str() && new_key.Get().is_str()) {
 			auto idx = find(key);
 			if (idx == npos) {
 				return false;
 			}
 
+			mark_dirty();
 			get_key_list(idx) = std::move(new_key.Get());
 
 			return true;
@@ -254,11 +390,12 @@ namespace claujson {
 	}
 
 	bool Object::change_key(uint64_t idx, Value new_key) {
-		if (this->is_object() && new_key.Get().is_str()) {
+		if (this->is_object() && !is_frozen() && new_key.Get().is_str()) {
 			if (idx == npos) {
 				return false;
 			}
 
+			mark_dirty();
 			get_key_list(idx) = std::move(new_key.Get());
 
 			return true;
@@ -268,6 +405,11 @@ namespace claujson {
 
 
 	bool Object::add_element(Value key, Value val) {
+		if (is_frozen()) {
+			return false;
+		}
+		mark_dirty();
+
 		if (val.Get().is_virtual()) {
 			if (val.Get().is_array()) {
 				Array* x = val.Get().as_array();
@@ -300,7 +442,22 @@ namespace claujson {
 		return true;
 	}
 
-	bool Object::assign_value_element(uint64_t idx, Value val) { this->obj_data[idx].second = std::move(val.Get()); return true; }
+	bool Object::assign_value_element(uint64_t idx, Value val) {
+		if (is_frozen()) {
+			return false;
+		}
+		mark_dirty();
+
+		if (val.Get().is_array()) {
+			val.Get().as_array()->set_parent(this);
+		}
+		else if (val.Get().is_object()) {
+			val.Get().as_object()->set_parent(this);
+		}
+
+		this->obj_data[idx].second = std::move(val.Get()); 
+		return true; 
+	}
 	//bool Object::assign_key_element(uint64_t idx, Value key) {
 	//	if (!key.Get() || !key.Get().is_str()) {
 	//		return false;
@@ -314,7 +471,22 @@ namespace claujson {
 		erase(idx, real);
 	}
 
+	void Object::erase(StringView key, bool real) {
+		uint64_t idx = this->find(key);
+		if (idx != npos) {
+			erase(idx, real);
+		}
+	}
+
+	void Object::erase(const Key& key, bool real) {
+		erase(key.view(), real);
+	}
+
 	void Object::erase(uint64_t idx, bool real) {
+		if (is_frozen()) {
+			return;
+		}
+		mark_dirty();
 
 		if (real) {
 			clean(obj_data[idx].first);
@@ -422,7 +594,7 @@ namespace claujson {
 		ERROR("Error Object::add_item_type");
 	}
 
-	void Object::add_user_type(_ValueType type
+	void Object::add_user_type(_ValueType type, bool /*parent*/
 
 	) {
 		// error
@@ -433,7 +605,7 @@ namespace claujson {
 	}
 
 	void Object::add_user_type(int64_t key_buf_idx, int64_t key_next_buf_idx, char* buf,
-		_ValueType type, uint64_t key_token_idx
+		_ValueType type, uint64_t key_token_idx, bool parent
 
 	) {
 
@@ -458,7 +630,9 @@ namespace claujson {
 					return;
 				}
 
-				json->set_parent(this);
+				if (parent) {
+					json->set_parent(this);
+				}
 				obj_data.emplace_back(std::move(temp), _Value(json));
 
 			}
@@ -470,7 +644,9 @@ namespace claujson {
 					return;
 				}
 
-				json->set_parent(this);
+				if (parent) {
+					json->set_parent(this);
+				}
 				obj_data.emplace_back(std::move(temp), _Value(json));
 
 			}
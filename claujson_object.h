@@ -6,6 +6,13 @@ namespace claujson {
 	protected:
 		std_vector<Pair<claujson::_Value, claujson::_Value>> obj_data;
 		Pointer parent;
+	private:
+		// hash of key -> idx, only for frozen object, built at first lookup and published with atomic. (readers do not lock)
+		struct KeyIndex;
+		mutable std::atomic<KeyIndex*> index{ nullptr };
+
+		const KeyIndex* key_index() const; // nullptr -> linear search.
+		uint64_t find(StringView key, uint64_t hash) const;
 
 	public:
 		static _Value data_null; // valid is false..
@@ -18,15 +25,22 @@ namespace claujson {
 	public:
 		friend class _Value;
 		friend class StructuredPtr;
+		friend class LoadData2;
 
 		Object* clone() const;
 
 		void set_parent(StructuredPtr);
 
 		uint64_t find(const _Value& key) const; // find without key`s converting ( \uxxxx )
+		uint64_t find(StringView key) const; // same, without making _Value. (no allocation for long key)
+		uint64_t find(const Key& key) const;
 
 		_Value& operator[](const _Value& key); // if not exist key, then _Value <- is not valid.
 		const _Value& operator[](const _Value& key) const; // if not exist key, then _Value <- is not valid.
+		_Value& operator[](StringView key);
+		const _Value& operator[](StringView key) const;
+		_Value& operator[](const Key& key);
+		const _Value& operator[](const Key& key) const;
 
 		_Value& operator[](uint64_t idx);
 
@@ -82,6 +96,13 @@ namespace claujson {
 
 		 bool is_virtual() const;
 
+		 // not changed after parsing, (ParseOption::keep_source)
+		 bool is_clean() const;
+		 // Document::freeze, then structural changes are ignored.
+		 bool is_frozen() const;
+		 // for changes through _Value& (ex. operator[]), marks also parents.
+		 void mark_dirty();
+
 		 void clear();
 
 
@@ -100,6 +121,8 @@ namespace claujson {
 		// bool assign_key_element(uint64_t idx, Value key);
 
 		 void erase(const _Value& key, bool real = false);
+		 void erase(StringView key, bool real = false); // if not exist key, then nothing.
+		 void erase(const Key& key, bool real = false);
 		 void erase(uint64_t idx, bool real = false);
 
 
@@ -115,12 +138,12 @@ namespace claujson {
 			char* buf, uint64_t val_token_idx);
 
 		 void add_user_type(int64_t key_buf_idx, int64_t key_next_buf_idx, char* buf,
-			_ValueType type, uint64_t key_token_idx
+			_ValueType type, uint64_t key_token_idx, bool parent
 
 		);
 
 		//
-		 void add_user_type(_ValueType type
+		 void add_user_type(_ValueType type, bool parent
 
 		); // int type -> enum?
 
@@ -242,7 +242,7 @@ namespace claujson {
 	}
 
 	 void PartialJson::add_user_type(int64_t key_buf_idx, int64_t key_next_buf_idx, char* buf,
-		_ValueType type, uint64_t key_token_idx
+		_ValueType type, uint64_t key_token_idx, bool parent
 
 	) {
 		{
@@ -274,7 +274,9 @@ namespace claujson {
 
 				obj_data.push_back({ std::move(temp), _Value(json) });
 
-				json.set_parent(StructuredPtr(this));
+				if (parent) {
+					json.set_parent(StructuredPtr(this));
+				}
 			}
 			else if (type == _ValueType::ARRAY) {
 				StructuredPtr json = new (std::nothrow) Array(
@@ -288,11 +290,13 @@ namespace claujson {
 
 				obj_data.push_back({ std::move(temp), _Value(json) });
 
-				json.set_parent(StructuredPtr(this));
+				if (parent) {
+					json.set_parent(StructuredPtr(this));
+				}
 			}
 		}
 	}
-	 void PartialJson::add_user_type(_ValueType type
+	 void PartialJson::add_user_type(_ValueType type, bool parent
 
 	) {
 		{
@@ -320,7 +324,9 @@ namespace claujson {
 
 			arr_vec.push_back(_Value(json));
 
-			json.set_parent(this);
+			if (parent) {
+				json.set_parent(this);
+			}
 		}
 	}
 
@@ -74,10 +74,10 @@ namespace claujson {
 			char* buf, uint64_t val_token_idx);
 
 		void add_user_type(int64_t key_buf_idx, int64_t key_next_buf_idx, char* buf,
-			_ValueType type, uint64_t key_token_idx
+			_ValueType type, uint64_t key_token_idx, bool parent
 
 		);
-		void add_user_type(_ValueType type
+		void add_user_type(_ValueType type, bool parent
 
 		);
 	};
@@ -822,6 +822,18 @@ namespace claujson {
 		return npos;
 	}
 
+	uint64_t _Value::find(StringView key) const {
+		if (is_object()) {
+			return as_object()->find(key);
+		}
+
+		return npos;
+	}
+
+	uint64_t _Value::find(const Key& key) const {
+		return find(key.view());
+	}
+
 
 	_Value& _Value::operator[](const _Value& key) { // if not exist key, then nothing.
 		if (is_object()) {
@@ -838,4 +850,26 @@ namespace claujson {
 		return empty_value;
 	}
 
+	_Value& _Value::operator[](StringView key) {
+		if (is_object()) {
+			return as_object()->operator[](key);
+		}
+
+		return empty_value;
+	}
+	const _Value& _Value::operator[](StringView key) const {
+		if (is_object()) {
+			return as_object()->operator[](key);
+		}
+
+		return empty_value;
+	}
+
+	_Value& _Value::operator[](const Key& key) {
+		return (*this)[key.view()];
+	}
+	const _Value& _Value::operator[](const Key& key) const {
+		return (*this)[key.view()];
+	}
+
 }
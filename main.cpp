@@ -14,10 +14,16 @@
 #include <ctime>
 
 #include "claujson.h" // using simdjson 3.9.1
+#include "claujson_jsonpath.h"
 
 #include "_simdjson.h"
 
 #include <cstring>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
 
 // using namespace std::literals::u8string_view_literals; // ?? 
 
@@ -78,6 +84,1195 @@ void str_test() {
 	
 }
 
+static int check_fail = 0;
+
+static void check(bool ok, const char* what) {
+	if (!ok) {
+		std::cout << "ERROR " << what << "\n";
+		++check_fail;
+	}
+}
+
+// keep_source with keep_parent = false, (keep_parent is ignored then) and write_parallel of a tree without parents.
+void incremental_test() {
+	std::cout << "incremental test\n";
+
+	std::string json = "{ \"a\" : [1, 2, {\"x\" : \"y\"}], \"b\" : { \"c\" : [ 3 ] } }";
+
+	claujson::parser p;
+	claujson::writer w;
+	claujson::ParseOption option;
+	option.keep_source = true;
+	option.keep_parent = false;
+
+	claujson::Document x;
+	check(p.parse_str(json, x, 1, option).first, "incremental parse");
+	check(x.has_parent(), "keep_source keeps parents");
+
+	x.Get()[0][2].as_object()->add_element(claujson::_Value("z"sv), claujson::_Value(5));
+
+	std::string out = w.write_incremental_to_str(x);
+	claujson::Document y;
+	check(p.parse_str(out, y, 1).first && w.write_to_str(y.Get()) == w.write_to_str(x.Get()), "write_incremental after nested edit");
+	check(out.find("{ \"c\" : [ 3 ] }") != std::string::npos, "write_incremental copies clean parts");
+
+	option.keep_source = false;
+	claujson::Document z;
+	check(p.parse_str("[{\"x\" : 1}, [2, 3], {\"y\" : [4]}]", z, 1, option).first, "parse without parents");
+	check(!z.has_parent(), "has_parent");
+	z.Get().as_array()->insert(0, claujson::Array::Make()); // has parent, others not.
+
+	const std::string expected = w.write_to_str(z.Get());
+	for (int i = 0; i < 2; ++i) {
+		if (i == 0) {
+			w.write_parallel("incremental_test.json", z.Get(), 2);
+		}
+		else {
+			w.write_parallel("incremental_test.json", z, 2);
+		}
+		claujson::Document k;
+		check(p.parse("incremental_test.json", k, 1).first && w.write_to_str(k.Get()) == expected, "write_parallel without parents");
+	}
+
+	// split points are checked, with and without parents, and with some new arrays (they have parents)
+	std::string big = "[";
+	for (int i = 0; i < 2000; ++i) {
+		big += (i ? ", " : "");
+		big += "{ \"a\" : [ " + std::to_string(i) + ", { \"b\" : [ 1, 2 ] } ], \"c\" : \"long string, not short string\" }";
+	}
+	big += "]";
+	for (int keep_parent = 0; keep_parent < 2; ++keep_parent) {
+		option.keep_parent = keep_parent == 1;
+		claujson::Document d;
+		check(p.parse_str(big, d, 4, option).first, "write_parallel parse");
+		for (uint64_t i = 0; i < 2000; i += 100) {
+			d.Get()[i]["a"sv].as_array()->add_element(claujson::Array::Make());
+		}
+		const std::string expected2 = w.write_to_str(d.Get());
+		for (uint64_t thr_num : { 2, 3, 4, 8 }) {
+			w.write_parallel("incremental_test.json", d.Get(), thr_num);
+			claujson::Document k;
+			check(p.parse("incremental_test.json", k, 1).first && w.write_to_str(k.Get()) == expected2, "write_parallel of big tree");
+		}
+	}
+}
+
+// mixed document for writer and reformat tests. (no floats and \\u escapes, reformat copies them as written)
+static std::string mixed_json(int n) {
+	std::string json = "{ \"list\" : [";
+	for (int i = 0; i < n; ++i) {
+		json += (i ? ", " : "");
+		switch (i % 5) {
+		case 0: json += "{ \"id\" : " + std::to_string(i) + ", \"name\" : \"long string, not short string \\\" \\\\ \\n\", \"tags\" : [ \"a\", \"b\" ] }"; break;
+		case 1: json += "[ 1, -2, 35, 0, true, false, null, [], {} ]"; break;
+		case 2: json += "\"\\t str \\r\""; break;
+		case 3: json += "{ \"deep\" : { \"deeper\" : [ [ [ " + std::to_string(i) + " ] ] ] }, \"empty\" : {} }"; break;
+		default: json += "-" + std::to_string(i); break;
+		}
+	}
+	json += "], \"end\" : 18446744073709551615, \"neg\" : -9223372036854775808 }";
+	return json;
+}
+
+// counts events, and checks each value against the tree with the path made from begin(path).
+class CheckSaxHandler : public claujson::SaxHandler {
+private:
+	struct Frame {
+		bool is_object;
+		uint64_t next; // index of next item.
+		std::string key;
+		std::string name; // in parent, for json pointer.
+	};
+	std::vector<Frame> stack;
+	const claujson::_Value& root;
+
+	std::string pointer(const Frame& now) const {
+		std::string str;
+		for (uint64_t i = 1; i < stack.size(); ++i) {
+			str += "/" + stack[i].name;
+		}
+		return str + "/" + (now.is_object ? now.key : std::to_string(now.next));
+	}
+	bool open(bool is_object) {
+		std::string name;
+		if (!stack.empty()) {
+			name = stack.back().is_object ? stack.back().key : std::to_string(stack.back().next);
+		}
+		stack.push_back({ is_object, 0, "", name });
+		++starts;
+		return true;
+	}
+	bool close() {
+		stack.pop_back();
+		if (!stack.empty()) {
+			++stack.back().next;
+		}
+		++ends;
+		return true;
+	}
+public:
+	uint64_t values = 0, keys = 0, starts = 0, ends = 0, bad = 0;
+	uint64_t depth = 0; // of begin(path).
+
+	explicit CheckSaxHandler(const claujson::_Value& root) : root(root) { }
+
+	bool begin(const claujson::std_vector<claujson::SaxLevel>& path) override {
+		depth = path.size();
+		for (uint64_t i = 0; i < path.size(); ++i) {
+			std::string name;
+			if (i > 0) {
+				name = path[i - 1].is_object ? path[i - 1].key : std::to_string(path[i - 1].index);
+			}
+			stack.push_back({ path[i].is_object, path[i].index, path[i].key, name });
+		}
+		return true;
+	}
+	bool start_object() override { return open(true); }
+	bool end_object() override { return close(); }
+	bool start_array() override { return open(false); }
+	bool end_array() override { return close(); }
+	bool key(const claujson::_Value& x) override {
+		bool fail = false;
+		stack.back().key = x.get_string().get_std_string(fail);
+		++keys;
+		return true;
+	}
+	bool value(const claujson::_Value& x) override {
+		++values;
+		if (stack.empty()) { // root is not array or object.
+			if (!(root == x)) {
+				++bad;
+			}
+			return true;
+		}
+		const std::string str = pointer(stack.back());
+		const claujson::_Value* y = claujson::JsonPointer(claujson::StringView(str)).get(root);
+		if (!y || !(*y == x)) {
+			++bad;
+		}
+		++stack.back().next;
+		return true;
+	}
+};
+
+void sax_test() {
+	std::cout << "sax test\n";
+
+	const std::string json = mixed_json(3000);
+
+	claujson::parser p;
+	claujson::Document x;
+	check(p.parse_str(json, x, 1).first, "sax parse");
+
+	uint64_t values = 0, keys = 0, containers = 0;
+	{
+		claujson::TreeCursor c(x.Get());
+		do {
+			const claujson::_Value& now = c.value();
+			if (now.is_structured()) {
+				++containers;
+				if (now.is_object()) {
+					keys += now.as_object()->get_data_size();
+				}
+			}
+			else {
+				++values;
+			}
+		} while (c.next());
+	}
+
+	for (uint64_t thr_num : { 1, 4, 8, 16 }) {
+		claujson::std_vector<std::unique_ptr<claujson::SaxHandler>> handlers;
+		auto result = p.parse_sax_str(json, [&]() { return std::unique_ptr<claujson::SaxHandler>(new CheckSaxHandler(x.Get())); }, handlers, thr_num);
+		check(result.first, "parse_sax_str");
+
+		uint64_t v = 0, k = 0, s = 0, e = 0, bad = 0, nested = 0;
+		for (auto& h : handlers) {
+			auto* ch = static_cast<CheckSaxHandler*>(h.get());
+			v += ch->values;
+			k += ch->keys;
+			s += ch->starts;
+			e += ch->ends;
+			bad += ch->bad;
+			nested += ch->depth > 1;
+		}
+		check(v == values && k == keys && s == containers && e == containers, "parse_sax_str counts");
+		check(bad == 0, "parse_sax_str paths of begin");
+		check(thr_num == 1 ? handlers.size() == 1 : handlers.size() > 1 && nested > 0, "parse_sax_str chunks");
+	}
+
+	claujson::std_vector<std::unique_ptr<claujson::SaxHandler>> handlers;
+	check(!p.parse_sax_str("[ 1, { \"a\" : ] }"sv, []() { return std::unique_ptr<claujson::SaxHandler>(new claujson::SaxHandler()); }, handlers, 4).first, "parse_sax_str of invalid json");
+}
+
+// parse with Projection, other values are skipped and arrays are compacted.
+void projection_test() {
+	std::cout << "projection test\n";
+
+	const char* items[] = { "{ \"p\" : { \"q\" : 1, \"r\" : 2 }, \"s\" : 3 }", "{ \"t\" : 4 }", "{ \"p\" : { \"q\" : [ 5, { \"u\" : 6 } ] } }", "{ \"p\" : 7 }", "8" };
+	const char* kept[] = { "{\"p\":{\"q\":1}}", "{}", "{\"p\":{\"q\":[5,{\"u\":6}]}}", "{}", nullptr };
+
+	std::string json = "{ \"a\" : [ 1, 2 ], \"recs\" : [";
+	std::string expected = "{\"recs\":[";
+	bool first = true;
+	for (int i = 0; i < 4000; ++i) {
+		json += (i ? ", " : "");
+		json += items[i % 5];
+		if (kept[i % 5]) {
+			expected += (first ? "" : ",");
+			expected += kept[i % 5];
+			first = false;
+		}
+	}
+	json += "], \"b\" : { \"c\" : { \"d\" : [ 8 ] }, \"e\" : 9 }, \"other\" : [ 1, 2, 3 ] }";
+	expected += "],\"b\":{\"c\":{\"d\":[8]}}}";
+
+	claujson::parser p;
+	claujson::writer w;
+
+	claujson::Projection projection;
+	check(projection.add("/recs/*/p/q"sv) && projection.add("$.b.c"sv), "projection add");
+	claujson::Projection invalid;
+	check(!invalid.add("/a~2"sv) && !invalid.add("$.a['b"sv), "projection add invalid path");
+
+	for (uint64_t thr_num : { 1, 2, 3, 4, 8 }) {
+		claujson::Document x;
+		check(p.parse_str(json, x, projection, thr_num).first && w.write_to_str(x.Get()) == expected, "parse_str with projection");
+	}
+
+	// index of array, compacted.
+	claujson::Projection index;
+	index.add("/other/1"sv);
+	claujson::Document y;
+	check(p.parse_str("{\"other\":[1,2,3]}"sv, y, index, 1).first && w.write_to_str(y.Get()) == "{\"other\":[2]}", "projection compacts array");
+	check(claujson::JsonPointer("/other/1"sv).get(y.Get()) == nullptr, "projection index changes");
+
+	claujson::Projection all;
+	all.add("$"sv);
+	claujson::Document z, z2;
+	check(p.parse_str(json, z, all, 4).first && p.parse_str(json, z2, 1).first && w.write_to_str(z.Get()) == w.write_to_str(z2.Get()), "projection of whole document");
+
+	claujson::Document bad;
+	check(!p.parse_str("{ \"recs\" : [ 1, }"sv, bad, projection, 1).first, "projection validates input");
+}
+
+// parallel_for runs each index once, nested in workers, and rethrows, with sleeping and spinning workers.
+void thread_pool_test() {
+	std::cout << "thread pool test\n";
+
+	for (size_t spin : { 0, 1000 }) {
+		ThreadPoolOption option;
+		option.spin = spin;
+
+		for (size_t threads : { 1, 3, 4 }) {
+			ThreadPool pool(threads, option);
+			check(pool.size() == threads, "pool size");
+
+			const size_t n = 10007;
+			std::vector<std::atomic<int>> counts(n + 5);
+			bool once = true;
+			for (size_t grain : { (size_t)0, (size_t)1, (size_t)7, (size_t)1000, n + 10 }) {
+				for (auto& c : counts) {
+					c.store(0);
+				}
+				pool.parallel_for(5, n + 5, grain, [&](size_t i) {
+					counts[i].fetch_add(1, std::memory_order_relaxed);
+				});
+				for (size_t i = 0; i < counts.size(); ++i) {
+					once = once && counts[i].load() == (i >= 5 ? 1 : 0);
+				}
+			}
+			check(once, "parallel_for runs each index once");
+
+			int calls = 0;
+			pool.parallel_for(3, 3, 1, [&](size_t) { ++calls; });
+			check(calls == 0, "parallel_for of empty range");
+
+			// nested, from parallel_for and from enqueued task.
+			std::vector<std::atomic<int>> nested(16 * 1000);
+			for (auto& c : nested) {
+				c.store(0);
+			}
+			pool.parallel_for(0, 16, 1, [&](size_t i) {
+				pool.parallel_for(0, 1000, 10, [&](size_t j) {
+					nested[i * 1000 + j].fetch_add(1, std::memory_order_relaxed);
+				});
+			});
+			auto future = pool.enqueue([&]() {
+				pool.parallel_for(0, 16 * 1000, 100, [&](size_t i) {
+					nested[i].fetch_add(1, std::memory_order_relaxed);
+				});
+				return 1;
+			});
+			check(future.get() == 1, "parallel_for in enqueued task");
+			bool twice = true;
+			for (auto& c : nested) {
+				twice = twice && c.load() == 2;
+			}
+			check(twice, "nested parallel_for");
+
+			// exception, also from nested parallel_for.
+			for (int depth = 0; depth < 2; ++depth) {
+				bool caught = false;
+				try {
+					pool.parallel_for(0, 1000, 1, [&](size_t i) {
+						if (depth == 0) {
+							if (i == 500) {
+								throw std::runtime_error("parallel_for test");
+							}
+							return;
+						}
+						pool.parallel_for(0, 10, 1, [&](size_t j) {
+							if (i == 500 && j == 5) {
+								throw std::runtime_error("parallel_for test");
+							}
+						});
+					});
+				}
+				catch (const std::runtime_error& e) {
+					caught = std::strcmp(e.what(), "parallel_for test") == 0;
+				}
+				check(caught, depth == 0 ? "parallel_for rethrows" : "nested parallel_for rethrows");
+			}
+
+			// still works after exception.
+			std::atomic<size_t> sum{ 0 };
+			pool.parallel_for(0, 100, 1, [&](size_t i) { sum.fetch_add(i); });
+			check(sum.load() == 4950, "parallel_for after exception");
+		}
+	}
+}
+
+// same output for all thread counts, with and without parents, and tokens with ParseOption::keep_jump.
+void round_trip_test() {
+	std::cout << "round trip test\n";
+
+	const std::string json = mixed_json(5000);
+
+	claujson::parser p;
+	claujson::writer w;
+	std::string expected;
+	{
+		claujson::Document x;
+		check(p.parse_str(json, x, 1).first, "round trip parse");
+		expected = w.write_to_str(x.Get());
+	}
+
+	for (int keep_parent = 0; keep_parent < 2; ++keep_parent) {
+		claujson::ParseOption option;
+		option.keep_parent = keep_parent == 1;
+		option.keep_jump = true;
+
+		bool same = true, written = true, jumps = true;
+		for (uint64_t thr_num = 1; thr_num <= 16; ++thr_num) {
+			claujson::Document x;
+			check(p.parse_str(json, x, thr_num, option).first, "round trip parse");
+			same = same && w.write_to_str(x.Get()) == expected;
+
+			std::string out;
+			claujson::BufferSink sink(out);
+			written = written && w.write_parallel2(sink, x.Get(), thr_num) && out == expected;
+
+			const uint64_t n = p.token_count();
+			jumps = jumps && n > 0 && p.match(0) == n - 1 && p.skip(0) == n;
+			for (uint64_t i = 0; i < n; ++i) {
+				const char ch = p.token(i);
+				if (ch == '[' || ch == '{') {
+					jumps = jumps && p.token(p.match(i)) == (ch == '[' ? ']' : '}') && p.skip(i) == p.match(i) + 1;
+				}
+			}
+		}
+		check(same, "write_to_str for all thread counts");
+		check(written, "write_parallel2 for all thread counts");
+		check(jumps, "match and skip for all thread counts");
+	}
+
+	claujson::ParseOption option;
+	option.keep_jump = true;
+	claujson::Document x;
+	// tokens: [ 1 , { "a" : [ 2 ] } , 3 ]
+	check(p.parse_str("[1,{\"a\":[2]},3]"sv, x, 1, option).first && p.token_count() == 13, "keep_jump parse");
+	check(p.token(0) == '[' && p.match(0) == 12 && p.token(12) == ']', "match of array");
+	check(p.token(3) == '{' && p.match(3) == 9 && p.token_offset(3) == 3, "match of object");
+	check(p.token(6) == '[' && p.match(6) == 8, "match of inner array");
+	check(p.skip(3) == 10 && p.token(10) == ',', "skip object");
+	check(p.token(4) == '"' && p.skip(4) == 9, "skip key : value");
+	check(p.skip(1) == 2 && p.skip(11) == 12, "skip number");
+
+	claujson::Document y;
+	check(p.parse_str("[1,2]"sv, y, 1).first && p.token_count() == 0, "no tokens without keep_jump");
+}
+
+void columns_test() {
+	std::cout << "columns test\n";
+
+	const int rows = 1000;
+	std::string json = "[";
+	for (int i = 0; i < rows; ++i) {
+		json += (i ? ", " : "");
+		if (i % 11 == 0) {
+			json += std::to_string(i); // not object.
+			continue;
+		}
+		std::string v;
+		switch (i % 7) {
+		case 0: break;
+		case 1: v = "\"v\" : \"str\""; break;
+		case 2: v = "\"v\" : -" + std::to_string(i); break;
+		case 3: v = "\"v\" : 18446744073709551615"; break;
+		case 4: v = "\"v\" : 9223372036854775807"; break;
+		case 5: v = "\"v\" : " + std::to_string(i) + ".5"; break;
+		default: v = "\"v\" : true"; break;
+		}
+		const std::string props = "\"props\" : { \"w\" : 0" + (v.empty() ? "" : ", " + v) + " }";
+		const std::string id = "\"id\" : " + std::to_string(i);
+		json += i % 2 ? "{ " + id + ", " + props + " }" : "{ " + props + ", \"x\" : [], " + id + " }"; // key order changes.
+	}
+	json += "]";
+
+	claujson::parser p;
+	claujson::Document x;
+	check(p.parse_str(json, x, 1).first, "columns parse");
+
+	typedef claujson::Column::Type Type;
+	const claujson::std_vector<std::string> v = { "props", "v" };
+	claujson::std_vector<claujson::Column> columns = {
+		claujson::Column(v, Type::DOUBLE), claujson::Column(v, Type::INT64), claujson::Column(v, Type::UINT64), claujson::Column(v, Type::BOOL),
+		claujson::Column("id", Type::INT64), claujson::Column("flag", Type::BOOL),
+	};
+
+	auto pool = std::make_shared<ThreadPool>(3);
+	claujson::extract_columns(*x.Get().as_array(), columns, pool);
+
+	uint64_t nulls[6] = { 0, 0, 0, 0, 0, 0 };
+	bool ok = true;
+	for (int i = 0; i < rows; ++i) {
+		const bool record = i % 11 != 0;
+		const int kind = record ? i % 7 : 0;
+
+		const bool d = kind == 2 || kind == 3 || kind == 4 || kind == 5;
+		const bool s = kind == 2 || kind == 4;
+		const bool u = kind == 3 || kind == 4;
+		const bool b = kind == 6;
+		const bool valid[6] = { d, s, u, b, record, false };
+		for (int c = 0; c < 6; ++c) {
+			ok = ok && columns[c].is_valid(i) == valid[c];
+			nulls[c] += !valid[c];
+		}
+		if (d) {
+			const double expected = kind == 2 ? -i : kind == 3 ? 18446744073709551615.0 : kind == 4 ? 9223372036854775807.0 : i + 0.5;
+			ok = ok && columns[0].f64[i] == expected;
+		}
+		if (s) {
+			ok = ok && columns[1].i64[i] == (kind == 2 ? -i : std::numeric_limits<int64_t>::max());
+		}
+		if (u) {
+			ok = ok && columns[2].u64[i] == (kind == 3 ? std::numeric_limits<uint64_t>::max() : (uint64_t)std::numeric_limits<int64_t>::max());
+		}
+		if (b) {
+			ok = ok && columns[3].b[i] == 1;
+		}
+		if (record) {
+			ok = ok && columns[4].i64[i] == i;
+		}
+	}
+	check(ok, "extract_columns values and valid");
+	for (int c = 0; c < 6; ++c) {
+		check(columns[c].valid.size() == (rows + 63) / 64 && columns[c].null_count == nulls[c], "extract_columns null_count");
+	}
+	check(columns[5].null_count == rows, "extract_columns missing column");
+
+	claujson::std_vector<claujson::Column> empty = { claujson::Column("id", Type::INT64) };
+	claujson::Document y;
+	check(p.parse_str("[]"sv, y, 1).first, "columns parse empty");
+	claujson::extract_columns(*y.Get().as_array(), empty, pool);
+	check(empty[0].i64.empty() && empty[0].valid.empty() && empty[0].null_count == 0, "extract_columns of empty array");
+}
+
+void cursor_test() {
+	std::cout << "cursor test\n";
+
+	std::string json = "{ \"meta\" : { \"skip\" : [ 1, { \"x\" : [ 2, 3, { \"y\" : {} } ] }, \"s\" ], \"n\" : 5 }, \"rows\" : [";
+	double expected = 0;
+	for (int i = 0; i < 3000; ++i) {
+		json += (i ? ", " : "");
+		if (i % 2) {
+			json += "{ \"b\" : [ \"x\", { \"c\" : [] } ], \"a\" : " + std::to_string(i) + ".5 }";
+			expected += i + 0.5;
+		}
+		else {
+			json += "{ \"a\" : -" + std::to_string(i) + ", \"b\" : \"long string, not short string\" }";
+			expected -= i;
+		}
+	}
+	json += "], \"after\" : true, \"z\" : null, \"big\" : 18446744073709551615, \"str\" : \"s\\n\" }";
+
+	claujson::parser p;
+	for (uint64_t thr_num : { 1, 4 }) {
+		check(p.parse_cursor_str(json, thr_num).first, "parse_cursor_str");
+		claujson::Cursor c = p.cursor();
+		claujson::StringView key;
+
+		check(c.enter_object() && c.next_key(key) && key == "meta"sv, "cursor first key");
+		check(c.enter_object() && c.next_key(key) && key == "skip"sv && c.type() == '[', "cursor nested key");
+		c.skip_value(); // nested containers.
+		int64_t n = 0;
+		check(c.next_key(key) && key == "n"sv && c.get_int64(n) && n == 5, "cursor after skip_value");
+		check(!c.next_key(key), "cursor end of object");
+
+		check(c.find_key("rows"sv) && c.enter_array(), "cursor find_key");
+		double sum = 0;
+		uint64_t rows = 0;
+		bool ok = true;
+		while (c.next_item()) {
+			ok = ok && c.enter_object() && c.find_key("a"sv);
+			double v = 0;
+			ok = ok && c.get_double(v);
+			sum += v;
+			while (c.next_key(key)) {
+				c.skip_value();
+			}
+			++rows;
+		}
+		check(ok && rows == 3000 && sum == expected, "cursor over array");
+
+		// after leaving the array.
+		bool b = false;
+		check(c.next_key(key) && key == "after"sv && c.get_bool(b) && b, "cursor next_key after array");
+
+		check(c.next_key(key) && key == "z"sv, "cursor key z");
+		const uint64_t token = c.token();
+		double d = 0;
+		claujson::StringView str;
+		int64_t i64 = 0;
+		check(!c.get_double(d) && !c.get_bool(b) && !c.get_string(str) && !c.get_int64(i64) && !c.enter_array() && !c.enter_object() && c.token() == token, "cursor type mismatch");
+		check(c.get_null() && c.token() != token, "cursor get_null");
+
+		uint64_t u64 = 0;
+		check(c.next_key(key) && key == "big"sv && !c.get_int64(i64) && c.get_uint64(u64) && u64 == 18446744073709551615ULL, "cursor uint64");
+		check(c.next_key(key) && key == "str"sv && !c.get_null() && c.get_string(str) && str == "s\n"sv, "cursor string");
+		check(!c.next_key(key) && c.at_end() && c.type() == 0, "cursor at end");
+	}
+
+	check(!p.parse_cursor_str("[ 1, 2 "sv, 1).first, "parse_cursor_str of invalid json");
+}
+
+// writer output through sinks is same as write_to_str.
+void sink_test() {
+	std::cout << "sink test\n";
+
+	claujson::parser p;
+	claujson::writer w;
+	claujson::Document x;
+	check(p.parse_str(mixed_json(2000), x, 1).first, "sink parse");
+
+	claujson::PrettyOption option;
+	option.compact_scalar_array = true;
+
+	for (int pretty = 0; pretty < 2; ++pretty) {
+		const std::string expected = pretty ? w.write_to_str(x.Get(), option) : w.write_to_str(x.Get());
+
+		for (uint64_t thr_num : { 0, 1, 2, 4, 8 }) {
+			std::string all;
+			char buf[100];
+			claujson::FixedBufferSink sink(buf, sizeof(buf), [&](const char* data, uint64_t used) {
+				all.append(data, used);
+				return true;
+			});
+			bool ok = thr_num == 0 ? (pretty ? w.write(sink, x.Get(), option) : w.write(sink, x.Get()))
+				: (pretty ? w.write_parallel2(sink, x.Get(), thr_num, option) : w.write_parallel2(sink, x.Get(), thr_num));
+			all.append(sink.data(), sink.size());
+			check(ok && all == expected, thr_num == 0 ? "write to FixedBufferSink" : "write_parallel2 to FixedBufferSink");
+		}
+	}
+	const std::string expected = w.write_to_str(x.Get());
+
+	// on_overflow returns false -> stop.
+	uint64_t calls = 0;
+	char buf[100];
+	claujson::FixedBufferSink stop(buf, sizeof(buf), [&](const char*, uint64_t) {
+		return ++calls < 3;
+	});
+	check(!w.write(stop, x.Get()) && calls == 3, "FixedBufferSink stop");
+	claujson::FixedBufferSink no_overflow(buf, sizeof(buf));
+	check(!w.write_parallel2(no_overflow, x.Get(), 4), "FixedBufferSink without on_overflow");
+
+	// appends.
+	std::string out = "prefix ";
+	claujson::BufferSink sink(out);
+	check(w.write_parallel2(sink, x.Get(), 4) && out == "prefix " + expected, "BufferSink appends");
+	claujson::BufferSink sink2(out);
+	check(w.write(sink2, x.Get()) && out == "prefix " + expected + expected, "BufferSink appends again");
+
+	// temp file.
+	std::FILE* file = std::tmpfile();
+	check(file != nullptr, "tmpfile");
+	if (file) {
+#ifdef _WIN32
+		const int fd = _fileno(file);
+#else
+		const int fd = fileno(file);
+#endif
+		claujson::FdSink fd_sink(fd, 256);
+		check(w.write_parallel2(fd_sink, x.Get(), 4), "write_parallel2 to FdSink");
+		claujson::FdSink fd_sink2(fd);
+		check(w.write(fd_sink2, x.Get()), "write to FdSink");
+
+		std::string read(expected.size() * 2 + 1, '\0');
+		std::fseek(file, 0, SEEK_SET);
+		read.resize(std::fread(&read[0], 1, read.size(), file));
+		check(read == expected + expected, "FdSink output");
+		std::fclose(file);
+	}
+}
+
+// reformat is byte-identical to writer, for all thread counts.
+void reformat_test() {
+	std::cout << "reformat test\n";
+
+	const std::string json = mixed_json(3000);
+
+	claujson::parser p;
+	claujson::writer w;
+	claujson::Document x;
+	check(p.parse_str(json, x, 1).first, "reformat parse");
+
+	claujson::PrettyOption option;
+	option.indent = 2;
+	option.indent_char = ' ';
+	option.compact_scalar_array = true;
+	option.newline_at_end = true;
+
+	const std::string minified = w.write_to_str(x.Get());
+	const std::string pretty = w.write_to_str(x.Get(), true);
+	const std::string custom = w.write_to_str(x.Get(), option);
+
+	for (uint64_t thr_num : { 1, 2, 3, 4, 8, 16 }) {
+		std::string out;
+		claujson::BufferSink sink(out);
+		check(p.reformat_str(json, sink, thr_num).first && out == minified, "reformat minify");
+
+		out.clear();
+		claujson::BufferSink sink2(out);
+		check(p.reformat_str(json, sink2, thr_num, true).first && out == pretty, "reformat pretty");
+
+		out.clear();
+		claujson::BufferSink sink3(out);
+		check(p.reformat_str(json, sink3, thr_num, option).first && out == custom, "reformat PrettyOption");
+
+		// small buffer, many chunk boundaries.
+		std::string all;
+		char buf[100];
+		claujson::FixedBufferSink fixed(buf, sizeof(buf), [&](const char* data, uint64_t used) {
+			all.append(data, used);
+			return true;
+		});
+		check(p.reformat_str(json, fixed, thr_num, option).first, "reformat FixedBufferSink");
+		all.append(fixed.data(), fixed.size());
+		check(all == custom, "reformat FixedBufferSink output");
+	}
+
+	std::string out;
+	claujson::BufferSink sink(out);
+	check(p.reformat_str("[ 3.5, 1e10, \"\\u00e9\" ]"sv, sink, 1).first && out == "[3.5,1e10,\"\\u00e9\"]", "reformat copies numbers and strings");
+
+	out.clear();
+	claujson::BufferSink sink2(out);
+	check(!p.reformat_str("{ \"a\" : [ 1, 2 }"sv, sink2, 4).first, "reformat of invalid json");
+}
+
+void visit_test() {
+	std::cout << "visit test\n";
+
+	std::string json = "{ \"values\" : [";
+	for (int i = 0; i < 5000; ++i) {
+		json += (i ? ", " : "");
+		json += std::to_string(i);
+	}
+	json += "], \"a\" : [ { \"c\" : 1 }, { \"d\" : 0 }, { \"c\" : 2 } ], \"b\" : [ 3, 4 ] }";
+
+	claujson::parser p;
+	claujson::Document x;
+	check(p.parse_str(json, x, 1).first, "visit parse");
+
+	auto pool = std::make_shared<ThreadPool>(3);
+
+	claujson::Projection values;
+	values.add("/values/*"sv);
+
+	// flat array, values are split into parts.
+	const uint64_t parts = 16;
+	std::vector<std::atomic<int64_t>> count(parts);
+	std::vector<int64_t> first(parts, -1), last(parts, -1);
+	claujson::parallel_visit(x.Get(), values, parts, [&](uint64_t part, const claujson::_Value& v) {
+		if (first[part] < 0) {
+			first[part] = v.get_integer();
+		}
+		last[part] = v.get_integer();
+		++count[part];
+	}, pool);
+	int64_t total = 0, used = 0, prev = -1;
+	bool in_order = true;
+	for (uint64_t i = 0; i < parts; ++i) {
+		total += count[i];
+		if (count[i] > 0) {
+			++used;
+			in_order = in_order && first[i] == prev + 1 && last[i] - first[i] + 1 == count[i];
+			prev = last[i];
+		}
+	}
+	check(total == 5000 && used > 1 && in_order, "parallel_visit of flat array");
+
+	int64_t sum = claujson::parallel_reduce(x.Get(), values, (int64_t)0,
+		[](int64_t acc, const claujson::_Value& v) { return acc + v.get_integer(); },
+		[](int64_t a, int64_t b) { return a + b; }, pool);
+	check(sum == 4999 * 5000 / 2, "parallel_reduce sum");
+
+	// order of parts, with values at different depths.
+	claujson::Projection mixed;
+	mixed.add("/a/*/c"sv);
+	mixed.add("/b/*"sv);
+	auto concat = [&](const claujson::_Value& root, const claujson::Projection& path) {
+		return claujson::parallel_reduce(root, path, std::string(),
+			[](std::string acc, const claujson::_Value& v) { return acc + std::to_string(v.get_integer()) + ","; },
+			[](std::string a, const std::string& b) { return a + b; }, pool);
+	};
+	check(concat(x.Get(), mixed) == "1,2,3,4,", "parallel_reduce in document order");
+
+	claujson::Document y;
+	check(p.parse_str("{\"a\":[{\"c\":1},{\"c\":2}],\"b\":[3,4]}"sv, y, 1).first, "visit parse small");
+	check(concat(y.Get(), mixed) == "1,2,3,4,", "parallel_reduce in document order, small");
+
+	mixed.add("/values/*"sv);
+	std::string expected;
+	for (int i = 0; i < 5000; ++i) {
+		expected += std::to_string(i) + ",";
+	}
+	expected += "1,2,3,4,";
+	check(concat(x.Get(), mixed) == expected, "parallel_reduce in document order, large");
+}
+
+// parsers and writers made without thr_num use default_pool(), also from a callback running on it.
+void nested_pool_test() {
+	std::cout << "nested pool test\n";
+
+	std::string json = "[";
+	for (int i = 0; i < 3000; ++i) {
+		json += (i ? ", " : "");
+		json += "{ \"a\" : [ 1, 2, { \"b\" : \"long string, not short string\" } ], \"c\" : " + std::to_string(i) + " }";
+	}
+	json += "]";
+
+	claujson::parser p;
+	claujson::writer w;
+	claujson::Document expected;
+	check(p.parse_str(json, expected, 1).first, "nested pool parse");
+	const std::string out = w.write_to_str(expected.Get());
+
+	claujson::Document items;
+	check(p.parse_str("[0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15]"sv, items, 1).first, "nested pool items");
+
+	std::atomic<int> bad{ 0 };
+	claujson::parallel_for_each(*items.Get().as_array(), [&](uint64_t i, claujson::_Value&) {
+		claujson::parser p;
+		claujson::writer w;
+		claujson::Document d;
+		if (!p.parse_str(json, d, i % 4).first || w.write_to_str(d.Get()) != out) { // thr_num = 0 -> cost model.
+			++bad;
+			return;
+		}
+		uint64_t n = 0;
+		if (!p.parse_array_str(json, [&](uint64_t, claujson::_Value&) { ++n; return true; }, 1 + i % 4).first || n != 3000) {
+			++bad;
+		}
+		std::string str;
+		claujson::BufferSink sink(str);
+		if (!w.write_parallel2(sink, d.Get(), 1 + i % 4) || str != out) {
+			++bad;
+		}
+		const std::string fileName = "nested_pool_test_" + std::to_string(i) + ".json";
+		w.write_parallel(fileName, d, 1 + i % 4);
+		claujson::Document y;
+		if (!p.parse(fileName, y, 1).first || w.write_to_str(y.Get()) != out) {
+			++bad;
+		}
+	});
+	check(bad == 0, "parse and write inside parallel_for_each");
+}
+
+// elements of root array in order, in windows of (thr_num * 8192) tokens.
+void parse_array_test() {
+	std::cout << "parse array test\n";
+
+	std::string json = "[";
+	for (int i = 0; i < 20000; ++i) {
+		json += (i ? ", " : "");
+		json += "{ \"i\" : " + std::to_string(i) + ", \"s\" : \"long string, not short string\", \"b\" : [ " + std::to_string(i) + " ] }";
+	}
+	json += "]";
+
+	claujson::parser p;
+	for (uint64_t thr_num : { 1, 2, 4 }) {
+		int64_t next = 0;
+		bool in_order = true;
+		auto x = p.parse_array_str(json, [&](uint64_t i, claujson::_Value& v) {
+			in_order = in_order && i == (uint64_t)next && v["i"sv].get_integer() == next && v["b"sv][0].get_integer() == next;
+			++next;
+			return true;
+		}, thr_num);
+		check(x.first && x.second == 20000 && next == 20000 && in_order, "parse_array_str order and count");
+
+		next = 0;
+		x = p.parse_array_str(json, [&](uint64_t, claujson::_Value&) {
+			return ++next < 12345;
+		}, thr_num);
+		check(x.first && x.second == 12345 && next == 12345, "parse_array_str stop");
+
+		std::vector<claujson::_Value> kept;
+		x = p.parse_array_str("[ [1, 2], {\"a\" : \"long string, not short string\"}, 3 ]"sv, [&](uint64_t, claujson::_Value& v) {
+			kept.push_back(std::move(v));
+			return true;
+		}, thr_num);
+		check(x.first && kept.size() == 3 && kept[0].is_array() && kept[1]["a"sv].is_str() && kept[2].get_integer() == 3, "parse_array_str move element");
+		for (auto& v : kept) {
+			claujson::clean(v);
+		}
+	}
+
+	// exception from on_element, after some windows.
+	bool thrown = false;
+	int64_t count = 0;
+	try {
+		p.parse_array_str(json, [&](uint64_t i, claujson::_Value&) {
+			++count;
+			if (i == 15000) {
+				throw std::runtime_error("stop");
+			}
+			return true;
+		}, 4);
+	}
+	catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	check(thrown && count == 15001, "parse_array_str exception");
+
+	check(!p.parse_array_str("{ \"a\" : 1 }"sv, [](uint64_t, claujson::_Value&) { return true; }, 2).first, "parse_array_str of object");
+}
+
+// old versions are destroyed after their readers leave, (pending() is 0)
+static bool wait_pending(const claujson::DocumentHandle& h) {
+	for (int i = 0; i < 5000 && h.pending() > 0; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return h.pending() == 0;
+}
+
+// readers and reloads at once, max_readers is less than reader threads, so read() spins sometimes.
+void handle_test() {
+	std::cout << "handle test\n";
+
+	auto make = [](int64_t v) {
+		return "{ \"v\" : " + std::to_string(v) + ", \"data\" : [ 1, 2, 3, { \"x\" : \"long string, not short string\" } ] }";
+	};
+
+	claujson::parser p;
+	claujson::Document d0;
+	check(p.parse_str(make(0), d0, 1).first, "handle parse");
+
+	claujson::DocumentHandle h(std::move(d0), nullptr, 2);
+	check(h.version() == 0 && h.pending() == 0, "handle version 0");
+	{
+		auto r0 = h.read();
+		check(r0->is_frozen() && r0.Get()["v"sv].get_integer() == 0, "handle read");
+
+		auto result = h.reload_str(make(1), 1).get();
+		check(result.first && h.version() == 1, "handle reload_str");
+		check(h.read().Get()["v"sv].get_integer() == 1, "handle read after reload");
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		check(h.pending() == 1 && r0.Get()["v"sv].get_integer() == 0, "handle keeps old version for reader");
+		check(r0.Get()["data"sv][3]["x"sv].get_string() == "long string, not short string"sv, "handle old version is valid");
+	}
+	check(wait_pending(h), "handle destroys old version");
+
+	check(!h.reload_str("{ \"v\" : ", 1).get().first && h.version() == 1, "handle reload of invalid json");
+
+	std::atomic<bool> stop{ false };
+	std::atomic<int> bad{ 0 };
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; ++t) {
+		readers.emplace_back([&]() {
+			int64_t last = 0;
+			while (!stop.load()) {
+				auto r = h.read();
+				const int64_t v = r.Get()["v"sv].get_integer();
+				if (v < last || (uint64_t)v > h.version() || !(r.Get()["data"sv][3]["x"sv].get_string() == "long string, not short string"sv)) {
+					++bad;
+				}
+				last = v;
+			}
+		});
+	}
+
+	for (int64_t v = 2; v <= 50; ++v) {
+		if (v % 2 == 0) {
+			check(h.reload_str(make(v), 1).get().first, "handle reload_str with readers");
+		}
+		else {
+			claujson::Document d;
+			check(p.parse_str(make(v), d, 1).first && h.publish(std::move(d)) == (uint64_t)v, "handle publish with readers");
+		}
+		check(h.version() == (uint64_t)v, "handle version");
+	}
+	stop = true;
+	for (auto& th : readers) {
+		th.join();
+	}
+	check(bad == 0, "handle readers see versions in order");
+	check(h.read().Get()["v"sv].get_integer() == 50, "handle last version");
+	check(wait_pending(h), "handle destroys old versions");
+}
+
+// lookups by StringView and Key, no _Value for the key.
+void key_lookup_test() {
+	std::cout << "key lookup test\n";
+
+	const std::string long_key(100, 'k');
+	std::string json = "{ \"a\" : 1, \"" + long_key + "\" : 2, \"name\" : { \"first\" : \"x\" }, \"\\u0062\" : 3 }";
+
+	claujson::parser p;
+	claujson::Document x;
+	check(p.parse_str(json, x, 1).first, "key lookup parse");
+	claujson::_Value& root = x.Get();
+	claujson::Object* obj = root.as_object();
+
+	static constexpr claujson::Key name("name");
+	static constexpr claujson::Key first("first");
+	static constexpr claujson::Key missing("missing");
+
+	check(obj->find("a"sv) == 0 && root.find("a"sv) == 0, "find by StringView");
+	check(obj->find(claujson::StringView(long_key)) == 1 && root.find(claujson::StringView(long_key)) == 1, "find long key");
+	check(obj->find(name) == 2 && root.find(name) == 2, "find by Key");
+	check(obj->find("b"sv) == 3, "find escaped key");
+	check(obj->find("missing"sv) == claujson::Object::npos && root.find(missing) == claujson::Object::npos, "find missing key");
+	check(obj->find("nam"sv) == claujson::Object::npos && obj->find("names"sv) == claujson::Object::npos, "find prefix of key");
+
+	check(root[claujson::StringView(long_key)].get_integer() == 2, "operator[] long key");
+	check(root[name][first].is_str() && root[name][first].get_string() == "x"sv, "operator[] by Key");
+	check(!root["missing"sv].is_valid() && !root[missing].is_valid() && !root[name]["a"sv].is_valid(), "operator[] missing key");
+	const claujson::_Value& croot = root;
+	check(croot[claujson::StringView(long_key)].get_integer() == 2 && croot[name].is_object(), "const operator[]");
+
+	obj->erase("missing"sv); // nothing.
+	obj->erase(missing);
+	check(obj->get_data_size() == 4, "erase missing key");
+	obj->erase(claujson::StringView(long_key));
+	check(obj->get_data_size() == 3 && obj->find(claujson::StringView(long_key)) == claujson::Object::npos && obj->find(name) == 1, "erase long key");
+	obj->erase(name);
+	check(obj->get_data_size() == 2 && obj->find("b"sv) == 1, "erase by Key");
+}
+
+// frozen document, concurrent lookups with the key index, mutators are refused.
+void freeze_test() {
+	std::cout << "freeze test\n";
+
+	std::string json = "{";
+	for (int i = 0; i < 64; ++i) {
+		json += "\"key_number_" + std::to_string(i) + "\" : " + std::to_string(i) + ", ";
+	}
+	json += "\"last\" : { \"a\" : 1 } }";
+
+	claujson::parser p;
+	claujson::Document x;
+	check(p.parse_str(json, x, 1).first, "freeze parse");
+	x.freeze();
+	check(x.is_frozen(), "is_frozen");
+
+	claujson::Object* obj = x.Get().as_object();
+	check(!obj->add_element(claujson::_Value("new"sv), claujson::_Value(1)), "add_element on frozen object");
+	check(obj->get_data_size() == 65, "size after refused add_element");
+
+	std::atomic<int> bad{ 0 };
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&, t]() {
+			const claujson::_Value& root = x.Get();
+			for (int i = 0; i < 1000; ++i) {
+				const int k = (i * 7 + t) % 64;
+				const std::string key = "key_number_" + std::to_string(k);
+				if (root.find(claujson::StringView(key.data(), key.size())) != (uint64_t)k) {
+					++bad;
+				}
+			}
+			static constexpr claujson::Key last("last");
+			if (root.find(last) != 64) {
+				++bad;
+			}
+		});
+	}
+	for (auto& th : threads) {
+		th.join();
+	}
+	check(bad == 0, "concurrent find on frozen object");
+
+	obj->mark_dirty(); // keeps the index.
+	check(x.Get().find(claujson::StringView("key_number_10", 13)) == 10, "find after mark_dirty on frozen object");
+}
+
+void jsonpath_test() {
+	std::cout << "jsonpath test\n";
+
+	std::string json = "{ \"store\" : { \"book\" : ["
+		"{ \"category\" : \"reference\", \"author\" : \"Nigel Rees\", \"price\" : 8.95 },"
+		"{ \"category\" : \"fiction\", \"author\" : \"Evelyn Waugh\", \"price\" : 12.99 },"
+		"{ \"category\" : \"fiction\", \"author\" : \"Herman Melville\", \"isbn\" : \"0-553-21311-3\", \"price\" : 8.99 },"
+		"{ \"category\" : \"fiction\", \"author\" : \"J. R. R. Tolkien\", \"isbn\" : \"0-395-19395-8\", \"price\" : 22.99 } ],"
+		"\"bicycle\" : { \"color\" : \"red\", \"price\" : 399 } } }";
+
+	claujson::parser p;
+	claujson::Document x;
+	check(p.parse_str(json, x, 1).first, "jsonpath parse");
+
+	auto count = [&](const char* query) -> int64_t {
+		claujson::JsonPath path(claujson::StringView(query, strlen(query)));
+		return path.valid() ? (int64_t)path.query(x.Get()).size() : -1;
+	};
+	check(count("$.store.book[*].author") == 4, "jsonpath $.store.book[*].author");
+	check(count("$..author") == 4, "jsonpath $..author");
+	check(count("$.store.*") == 2, "jsonpath $.store.*");
+	check(count("$..price") == 5, "jsonpath $..price");
+	check(count("$..book[2]") == 1, "jsonpath $..book[2]");
+	check(count("$..book[-1]") == 1, "jsonpath $..book[-1]");
+	check(count("$..book[0,1]") == 2, "jsonpath $..book[0,1]");
+	check(count("$..book[:2]") == 2, "jsonpath $..book[:2]");
+	check(count("$..book[?@.isbn]") == 2, "jsonpath $..book[?@.isbn]");
+	check(count("$..book[?@.price < 10]") == 2, "jsonpath $..book[?@.price < 10]");
+	check(count("$..book[?@.category == 'fiction' && @.price > 10]") == 2, "jsonpath filter with &&");
+	check(count("$..*") == 23, "jsonpath $..*");
+
+	check(count("$.a[?@.x == 01]") == -1, "jsonpath leading zero in number");
+	check(count("$.a[?@.x == -01]") == -1, "jsonpath leading zero in negative number");
+	check(count("$.a[01]") == -1, "jsonpath leading zero in index");
+	check(count("$.a[-0]") == -1, "jsonpath -0 index");
+	check(count("$.a[?@.x == 0]") == 0 && count("$.a[?@.x == 0.5]") == 0, "jsonpath zero");
+
+	// large array, parallel results in document order.
+	std::string big = "{ \"items\" : [";
+	for (int i = 0; i < 10000; ++i) {
+		big += (i ? "," : "");
+		big += "{ \"i\" : " + std::to_string(i) + ", \"g\" : " + std::to_string(i % 3) + " }";
+	}
+	big += "] }";
+	claujson::Document y;
+	check(p.parse_str(big, y, 1).first, "jsonpath parse big");
+
+	auto pool = std::make_shared<ThreadPool>(2);
+	claujson::JsonPath filter("$.items[?@.g == 1].i"sv);
+	auto result = filter.query(y.Get(), pool);
+	bool same = result.size() == 3333;
+	for (uint64_t i = 0; same && i < result.size(); ++i) {
+		same = result[i]->get_integer() == (int64_t)(i * 3 + 1);
+	}
+	check(same, "jsonpath parallel filter");
+
+	claujson::JsonPath desc("$..i"sv);
+	auto result2 = desc.query(y.Get(), pool);
+	same = result2.size() == 10000;
+	for (uint64_t i = 0; same && i < result2.size(); ++i) {
+		same = result2[i]->get_integer() == (int64_t)i;
+	}
+	check(same, "jsonpath parallel descendant");
+
+	int64_t next = 1;
+	uint64_t calls = filter.for_each(y.Get(), [&](const claujson::_Value& v) {
+		same = same && v.get_integer() == next;
+		next += 3;
+		return next < 100;
+	}, pool);
+	check(same && calls == 33, "jsonpath for_each stop");
+}
+
+void pointer_test() {
+	std::cout << "pointer test\n";
+
+	std::string json = "{ \"a\" : { \"b\" : [ 10, { \"c\" : \"x\" } ] }, \"d/e\" : 1, \"f~g\" : 2, \"\" : 3,"
+		" \"rec\" : [ { \"id\" : 0, \"name\" : \"n0\" }, { \"id\" : 1, \"name\" : \"n1\" }, { \"name\" : \"n2\", \"id\" : 2 }, { \"id\" : 3 } ] }";
+
+	claujson::parser p;
+	claujson::Document x;
+	check(p.parse_str(json, x, 1).first, "pointer parse");
+	const claujson::_Value& root = x.Get();
+
+	auto get = [&](const char* str) -> const claujson::_Value* {
+		claujson::JsonPointer ptr(claujson::StringView(str, strlen(str)));
+		return ptr.valid() ? ptr.get(root) : nullptr;
+	};
+	check(get("") == &root, "pointer root");
+	check(get("/a/b/0") && get("/a/b/0")->get_integer() == 10, "pointer /a/b/0");
+	check(get("/a/b/1/c") && get("/a/b/1/c")->get_string() == "x"sv, "pointer /a/b/1/c");
+	check(get("/d~1e") && get("/d~1e")->get_integer() == 1, "pointer ~1");
+	check(get("/f~0g") && get("/f~0g")->get_integer() == 2, "pointer ~0");
+	check(get("/") && get("/")->get_integer() == 3, "pointer empty key");
+	check(!claujson::JsonPointer("a/b"sv).valid() && !claujson::JsonPointer("/a~2"sv).valid(), "invalid pointer");
+	check(claujson::JsonPointer("/d~1e/~0"sv).key(0) == "d/e" && claujson::JsonPointer("/d~1e/~0"sv).key(1) == "~", "pointer key");
+	check(!get("/a/b/2") && !get("/a/b/01") && !get("/a/b/-") && !get("/a/x") && !get("/a/b/0/c"), "missing path");
+
+	// same pointer on many records, slot cache, (order of keys changes at rec/2)
+	claujson::JsonPointer name("/name"sv);
+	const claujson::Array* rec = root["rec"sv].as_array();
+	for (int round = 0; round < 2; ++round) {
+		for (uint64_t i = 0; i < rec->size(); ++i) {
+			const claujson::_Value* v = name.get(rec->get_value_list(i));
+			check(i == 3 ? v == nullptr : v && v->get_string() == claujson::StringView("n" + std::to_string(i)), "pointer with slot cache");
+		}
+	}
+
+	// after changes of the document.
+	claujson::Object* first = x.Get()["rec"sv][0].as_object();
+	first->erase("id"sv);
+	check(name.get(x.Get()["rec"sv][0]) && name.get(x.Get()["rec"sv][0])->get_string() == "n0"sv, "pointer after erase");
+	first->erase("name"sv);
+	check(name.get(x.Get()["rec"sv][0]) == nullptr, "pointer after erase of target");
+	first->add_element(claujson::_Value("other"sv), claujson::_Value(0));
+	first->add_element(claujson::_Value("name"sv), claujson::_Value("m0"sv));
+	check(name.get(x.Get()["rec"sv][0]) && name.get(x.Get()["rec"sv][0])->get_string() == "m0"sv, "pointer after add");
+
+	claujson::JsonPointer copy(name);
+	check(copy.get(x.Get()["rec"sv][1]) && copy.get(x.Get()["rec"sv][1])->get_string() == "n1"sv, "copy of pointer");
+}
+
+// diff -> patch round trip, mixed replace/remove/add with paths sharing prefixes.
+void patch_test() {
+	std::cout << "patch test\n";
+
+	const char* pairs[][2] = {
+		{ "{ \"a\" : { \"b\" : { \"c\" : 1, \"d\" : 2, \"e\" : 3 }, \"bb\" : 4 } }",
+		  "{ \"a\" : { \"b\" : { \"c\" : 10, \"e\" : 3, \"f\" : [1] }, \"bb\" : 5, \"b2\" : null } }" },
+		{ "{ \"a\" : [ 1, 2, 3, 4, 5 ], \"a1\" : [ [1, 2], [3] ] }",
+		  "{ \"a\" : [ 1, 3, 4 ], \"a1\" : [ [1, 2, 6], [3], [7] ] }" },
+		{ "{ \"x\" : [ { \"y\" : 1 }, { \"y\" : 2, \"z\" : 3 } ], \"xy\" : \"s\" }",
+		  "{ \"x\" : [ { \"y\" : 1, \"w\" : true }, { \"z\" : 4 }, 5, 6 ] }" },
+		{ "[ 1, { \"a\" : [ 2, 3 ] }, 4, 5 ]", "[ 0, { \"a\" : [ 3 ], \"b\" : {} } ]" },
+		{ "{ \"a\" : 1 }", "[ 1, 2 ]" },
+	};
+
+	claujson::parser p;
+	claujson::writer w;
+	for (auto& pair : pairs) {
+		claujson::Document x, y;
+		check(p.parse_str(pair[0], x, 1).first && p.parse_str(pair[1], y, 1).first, "patch parse");
+
+		claujson::Document z = claujson::diff(x.Get(), y.Get());
+		check(z.Get().is_array(), "diff result");
+
+		claujson::_Value& patched = claujson::patch(x.Get(), z.Get());
+		check(w.write_to_str(patched) == w.write_to_str(y.Get()), pair[1]);
+
+		claujson::Document same = claujson::diff(y.Get(), y.Get());
+		check(same.Get().is_array() && same.Get().as_array()->empty(), "diff of same values");
+	}
+}
+
 void diff_test() {
 	std::cout << "diff test\n";
 
@@ -811,6 +2006,39 @@ void diff_test2() {
 
 */
 
+// back-to-back parse of one file, latency with sleeping workers vs spinning workers.
+//  [program name] [json file name] (number of thread) latency
+void latency_test(const char* fileName, int thr_num) {
+	std::string str;
+	{
+		std::ifstream in(fileName, std::ios::binary);
+		str.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+
+	claujson::log.no_print();
+
+	for (int mode = 0; mode < 2; ++mode) {
+		ThreadPoolOption option;
+		if (mode == 1) {
+			option.spin = 1 << 14;
+		}
+		auto pool = std::make_shared<ThreadPool>(std::max((int)std::thread::hardware_concurrency() - 2, 1), option);
+		claujson::parser p(pool);
+
+		std::vector<double> us;
+		for (int i = 0; i < 200; ++i) {
+			claujson::Document d;
+			auto a = std::chrono::steady_clock::now();
+			p.parse_str(claujson::StringView(str.data(), str.size()), d, thr_num);
+			auto b = std::chrono::steady_clock::now();
+			us.push_back(std::chrono::duration<double, std::micro>(b - a).count());
+		}
+		std::sort(us.begin(), us.end());
+		std::cout << (mode == 0 ? "sleep " : "spin ") << str.size() << " bytes, p50 " << us[us.size() / 2]
+			<< "us p99 " << us[us.size() * 99 / 100] << "us\n";
+	}
+}
+
 int main(int argc, char* argv[])
 {
 	{
@@ -859,6 +2087,47 @@ int main(int argc, char* argv[])
 		std::cout << "----------" << std::endl;
 		diff_test();
 		std::cout << "----------" << std::endl;
+		incremental_test();
+		std::cout << "----------" << std::endl;
+		freeze_test();
+		std::cout << "----------" << std::endl;
+		jsonpath_test();
+		std::cout << "----------" << std::endl;
+		patch_test();
+		std::cout << "----------" << std::endl;
+		pointer_test();
+		std::cout << "----------" << std::endl;
+		key_lookup_test();
+		std::cout << "----------" << std::endl;
+		handle_test();
+		std::cout << "----------" << std::endl;
+		nested_pool_test();
+		std::cout << "----------" << std::endl;
+		visit_test();
+		std::cout << "----------" << std::endl;
+		reformat_test();
+		std::cout << "----------" << std::endl;
+		sink_test();
+		std::cout << "----------" << std::endl;
+		sax_test();
+		std::cout << "----------" << std::endl;
+		cursor_test();
+		std::cout << "----------" << std::endl;
+		projection_test();
+		std::cout << "----------" << std::endl;
+		columns_test();
+		std::cout << "----------" << std::endl;
+		round_trip_test();
+		std::cout << "----------" << std::endl;
+		thread_pool_test();
+		std::cout << "----------" << std::endl;
+		parse_array_test();
+		std::cout << "----------" << std::endl;
+
+		if (check_fail > 0) {
+			std::cout << check_fail << " checks failed\n";
+			return 1;
+		}
 	//	diff_test2(); // chk bug..
 		std::cout << "----------" << std::endl;
 
@@ -955,6 +2224,11 @@ int main(int argc, char* argv[])
 				thr_num = std::atoi(argv[2]);
 			}
 
+			if (argc > 3 && std::string(argv[3]) == "latency") {
+				latency_test(argv[1], thr_num);
+				return 0;
+			}
+
 			claujson::parser p(thr_num);
 			
 			for (int i = 0; i < 15; ++i) {
@@ -2,185 +2,374 @@
 #define THREAD_POOL_H
 
 #include <vector>
-#include <queue>
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
 #include <future>
 #include <functional>
 #include <stdexcept>
+#include <exception>
+#include <algorithm>
 
-#if __cpp_lib_is_invocable
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+struct ThreadPoolOption {
+    // idle worker checks for tasks `spin` times (with pause) before sleep. 0 -> sleep at once.
+    //  lower wake latency for back-to-back small jobs, but idle workers use cpu for a while.
+    size_t spin = 0;
+    // worker i runs only on cpus[i % cpus.size()]. empty -> not pinned. (linux only, for now)
+    std::vector<int> cpus;
+};
+
+inline void thread_pool_pause() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+inline void thread_pool_pin(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+// work-stealing pool, (based on progschj/ThreadPool)
+//   each worker has its own queue, pops own tasks from back, steals from front of others.
+//   enqueue -> std::future, parallel_for -> fork-join without heap allocation,
+//   threads waiting in parallel_for run other tasks.
 class ThreadPool {
 public:
-    ThreadPool(size_t);
+#if __cpp_lib_is_invocable
     template<class F, class... Args>
-    auto enqueue(F f, Args&&... args) 
-        -> std::future<typename std::invoke_result<F, Args...>::type>;
+    using result_t = typename std::invoke_result<F, Args...>::type;
+#else
+    template<class F, class... Args>
+    using result_t = typename std::result_of<F(Args...)>::type;
+#endif
+public:
+    explicit ThreadPool(size_t);
+    ThreadPool(size_t, const ThreadPoolOption& option);
     ~ThreadPool();
+
+    template<class F, class... Args>
+    auto enqueue(F&& f, Args&&... args)
+        -> std::future<result_t<F, Args...>>;
+
+    // f(i) for i in [begin, end), `grain` indices per task. returns when all are done.
+    //   the calling thread takes part. exception from f is rethrown here.
+    template<class F>
+    void parallel_for(size_t begin, size_t end, size_t grain, F&& f);
+
+    size_t size() const { return n; }
 private:
+    // intrusive task, parallel_for uses one on its stack.
+    struct Task {
+        void (*run)(Task*);
+    };
+
+    template<class R>
+    struct FutureTask : Task {
+        std::packaged_task<R()> task;
+
+        template<class G>
+        explicit FutureTask(G&& g) : task(std::forward<G>(g)) {
+            this->run = [](Task* x) {
+                auto* self = static_cast<FutureTask*>(x);
+                self->task();
+                delete self;
+            };
+        }
+    };
+
+    template<class F>
+    struct ForTask : Task {
+        F& f;
+        const size_t end;
+        const size_t grain;
+        std::atomic<size_t> next;
+        std::atomic<size_t> count; // pushed and not finished.
+        std::atomic<bool> failed{ false };
+        std::exception_ptr error;
+
+        ForTask(F& f, size_t begin, size_t end, size_t grain, size_t count)
+            : f(f), end(end), grain(grain), next(begin), count(count) {
+            this->run = [](Task* x) {
+                auto* self = static_cast<ForTask*>(x);
+                self->work();
+                self->count.fetch_sub(1, std::memory_order_acq_rel);
+            };
+        }
+
+        void work() {
+            for (;;) {
+                size_t i = next.fetch_add(grain, std::memory_order_relaxed);
+                if (i >= end) {
+                    return;
+                }
+                size_t last = std::min(end, i + grain);
+                try {
+                    for (; i < last; ++i) {
+                        f(i);
+                    }
+                }
+                catch (...) {
+                    bool expected = false;
+                    if (failed.compare_exchange_strong(expected, true)) {
+                        error = std::current_exception();
+                    }
+                    next.store(end, std::memory_order_relaxed); // stop others.
+                    return;
+                }
+            }
+        }
+    };
+
+    // ring buffer, grows and never shrinks -> no allocation in steady state.
+    struct Queue {
+        std::mutex mutex;
+        std::vector<Task*> ring; // size is 2^n
+        size_t head = 0; // [head, tail)
+        size_t tail = 0;
+
+        bool empty() const { return head == tail; }
+        void push_back(Task* task) {
+            if (tail - head == ring.size())
+                grow();
+            ring[tail++ & (ring.size() - 1)] = task;
+        }
+        Task* pop_back() { return ring[--tail & (ring.size() - 1)]; }
+        Task* pop_front() { return ring[head++ & (ring.size() - 1)]; }
+        void grow() {
+            std::vector<Task*> temp(std::max<size_t>(64, ring.size() * 2));
+            for (size_t i = head; i < tail; ++i)
+                temp[i - head] = ring[i & (ring.size() - 1)];
+            tail -= head;
+            head = 0;
+            ring.swap(temp);
+        }
+    };
+
+    void push(Task* task, size_t count = 1);
+    Task* take(size_t self);
+    bool run_one();
+
+    // index of worker in this pool, or size() for other threads.
+    size_t self_index() const {
+        return current_pool() == this ? current_index() : n;
+    }
+    static const ThreadPool*& current_pool() {
+        static thread_local const ThreadPool* pool = nullptr;
+        return pool;
+    }
+    static size_t& current_index() {
+        static thread_local size_t idx = 0;
+        return idx;
+    }
+private:
+    const size_t n; // number of workers, (workers is not safe to read while starting)
+    const size_t spin;
     // need to keep track of threads so we can join them
     std::vector< std::thread > workers;
-    // the task queue
-    std::queue< std::function<void()> > tasks;
-    
+    // the task queues, one per worker
+    std::unique_ptr<Queue[]> queues;
+
     // synchronization
-    std::mutex queue_mutex;
+    std::atomic<size_t> pending; // tasks in queues (maybe being pushed)
+    std::atomic<size_t> sleepers;
+    std::atomic<size_t> next_queue; // for other threads, round robin.
+    std::mutex sleep_mutex;
     std::condition_variable condition;
-    bool stop;
+    std::atomic<bool> stop;
 };
- 
-// the constructor just launches some amount of workers
+
 inline ThreadPool::ThreadPool(size_t threads)
-    :   stop(false)
+    :   ThreadPool(threads, ThreadPoolOption())
+{
+}
+
+// the constructor just launches some amount of workers
+inline ThreadPool::ThreadPool(size_t threads, const ThreadPoolOption& option)
+    :   n(threads), spin(option.spin), queues(new Queue[threads > 0 ? threads : 1]), pending(0), sleepers(0), next_queue(0), stop(false)
 {
     for(size_t i = 0;i<threads;++i)
         workers.emplace_back(
-            [this]
+            [this, i, cpu = option.cpus.empty() ? -1 : option.cpus[i % option.cpus.size()]]
             {
+                current_pool() = this;
+                current_index() = i;
+
+                if (cpu >= 0)
+                    thread_pool_pin(cpu);
+
                 for(;;)
                 {
-                    std::function<void()> task;
-
-                    {
-                        std::unique_lock<std::mutex> lock(this->queue_mutex);
-                        this->condition.wait(lock,
-                            [this]{ return this->stop || !this->tasks.empty(); });
-                        if(this->stop && this->tasks.empty())
-                            return;
-                        task = std::move(this->tasks.front());
-                        this->tasks.pop();
+                    Task* task = take(i);
+                    for (size_t k = 0; !task && k < this->spin && !this->stop; ++k) {
+                        thread_pool_pause();
+                        if (this->pending.load(std::memory_order_relaxed) > 0)
+                            task = take(i);
+                    }
+                    if (task) {
+                        task->run(task);
+                        continue;
                     }
 
-                    task();
+                    std::unique_lock<std::mutex> lock(this->sleep_mutex);
+                    if (this->stop && this->pending.load() == 0)
+                        return;
+                    this->sleepers.fetch_add(1);
+                    this->condition.wait(lock,
+                        [this]{ return this->stop || this->pending.load() > 0; });
+                    this->sleepers.fetch_sub(1);
                 }
             }
         );
 }
 
-// add new work item to the pool
-template<class F, class... Args>
-auto ThreadPool::enqueue(F f, Args&&... args) 
-    -> std::future<typename std::invoke_result<F, Args...>::type>
+inline void ThreadPool::push(Task* task, size_t count)
 {
-    using return_type = typename std::invoke_result<F, Args...>::type;
+    if (n == 0) { // no worker, just run.
+        for (size_t i = 0; i < count; ++i)
+            task->run(task);
+        return;
+    }
 
-    auto task = std::make_shared< std::packaged_task<return_type()> >(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-        );
-        
-    std::future<return_type> res = task->get_future();
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
+    pending.fetch_add(count);
 
-        // don't allow enqueueing after stopping the pool
-        if(stop)
-            throw std::runtime_error("enqueue on stopped ThreadPool");
+    size_t idx = self_index();
+    if (idx == n)
+        idx = next_queue.fetch_add(1, std::memory_order_relaxed) % n;
+    {
+        std::unique_lock<std::mutex> lock(queues[idx].mutex);
+        for (size_t i = 0; i < count; ++i)
+            queues[idx].push_back(task);
+    }
 
-        tasks.emplace([task](){ (*task)(); });
+    if (sleepers.load() > 0) {
+        { std::unique_lock<std::mutex> lock(sleep_mutex); }
+        if (count > 1)
+            condition.notify_all();
+        else
+            condition.notify_one();
     }
-    condition.notify_one();
-    return res;
 }
 
-// the destructor joins all threads
-inline ThreadPool::~ThreadPool()
+// own tasks from back (LIFO), others from front (FIFO).
+inline ThreadPool::Task* ThreadPool::take(size_t self)
 {
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        stop = true;
+    if (pending.load() == 0)
+        return nullptr;
+
+    if (self < n) {
+        std::unique_lock<std::mutex> lock(queues[self].mutex);
+        if (!queues[self].empty()) {
+            Task* task = queues[self].pop_back();
+            pending.fetch_sub(1);
+            return task;
+        }
     }
-    condition.notify_all();
-    for(std::thread &worker: workers)
-        worker.join();
+    for (size_t k = 1; k <= n; ++k) {
+        const size_t victim = (self + k) % n;
+        if (victim == self)
+            continue;
+        std::unique_lock<std::mutex> lock(queues[victim].mutex);
+        if (!queues[victim].empty()) {
+            Task* task = queues[victim].pop_front();
+            pending.fetch_sub(1);
+            return task;
+        }
+    }
+    return nullptr;
 }
-#else
-class ThreadPool {
-public:
-    ThreadPool(size_t);
-    template<class F, class... Args>
-    auto enqueue(F&& f, Args&&... args)
-        -> std::future<typename std::result_of<F(Args...)>::type>;
-    ~ThreadPool();
-private:
-    // need to keep track of threads so we can join them
-    std::vector< std::thread > workers;
-    // the task queue
-    std::queue< std::function<void()> > tasks;
-
-    // synchronization
-    std::mutex queue_mutex;
-    std::condition_variable condition;
-    bool stop;
-};
 
-// the constructor just launches some amount of workers
-inline ThreadPool::ThreadPool(size_t threads)
-    : stop(false)
+inline bool ThreadPool::run_one()
 {
-    for (size_t i = 0; i < threads; ++i)
-        workers.emplace_back(
-            [this]
-            {
-                for (;;)
-                {
-                    std::function<void()> task;
-
-                    {
-                        std::unique_lock<std::mutex> lock(this->queue_mutex);
-                        this->condition.wait(lock,
-                            [this] { return this->stop || !this->tasks.empty(); });
-                        if (this->stop && this->tasks.empty())
-                            return;
-                        task = std::move(this->tasks.front());
-                        this->tasks.pop();
-                    }
-
-                    task();
-                }
-            }
-            );
+    Task* task = take(self_index());
+    if (!task)
+        return false;
+    task->run(task);
+    return true;
 }
 
 // add new work item to the pool
 template<class F, class... Args>
 auto ThreadPool::enqueue(F&& f, Args&&... args)
--> std::future<typename std::result_of<F(Args...)>::type>
+    -> std::future<result_t<F, Args...>>
 {
-    using return_type = typename std::result_of<F(Args...)>::type;
+    using return_type = result_t<F, Args...>;
 
-    auto task = std::make_shared< std::packaged_task<return_type()> >(
-        std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-    );
+    // don't allow enqueueing after stopping the pool
+    if(stop)
+        throw std::runtime_error("enqueue on stopped ThreadPool");
 
-    std::future<return_type> res = task->get_future();
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
+    auto* task = new FutureTask<return_type>(
+            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
+        );
 
-        // don't allow enqueueing after stopping the pool
-        if (stop)
-            throw std::runtime_error("enqueue on stopped ThreadPool");
+    std::future<return_type> res = task->task.get_future();
+    push(task);
+    return res;
+}
 
-        tasks.emplace([task]() { (*task)(); });
+template<class F>
+void ThreadPool::parallel_for(size_t begin, size_t end, size_t grain, F&& f)
+{
+    if (begin >= end)
+        return;
+    if (grain == 0)
+        grain = 1;
+
+    const size_t chunks = (end - begin - 1) / grain + 1;
+    const size_t helpers = std::min(chunks - 1, n);
+
+    if (helpers == 0) {
+        for (size_t i = begin; i < end; ++i)
+            f(i);
+        return;
     }
-    condition.notify_one();
-    return res;
+
+    ForTask<typename std::remove_reference<F>::type> job(f, begin, end, grain, helpers);
+    push(&job, helpers);
+
+    job.work();
+
+    // wait, run other tasks meanwhile. (also own entries still in queues)
+    while (job.count.load(std::memory_order_acquire) > 0) {
+        if (!run_one())
+            std::this_thread::yield();
+    }
+
+    if (job.failed.load())
+        std::rethrow_exception(job.error);
 }
 
 // the destructor joins all threads
 inline ThreadPool::~ThreadPool()
 {
     {
-        std::unique_lock<std::mutex> lock(queue_mutex);
+        std::unique_lock<std::mutex> lock(sleep_mutex);
         stop = true;
     }
     condition.notify_all();
-    for (std::thread& worker : workers)
+    for(std::thread &worker: workers)
         worker.join();
 }
 
 #endif
-
-#endif
-